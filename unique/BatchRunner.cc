@@ -0,0 +1,193 @@
+#include "BatchRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "Statistics.h"
+
+namespace fs = std::filesystem;
+
+static volatile sig_atomic_t batch_interrupted = 0;
+
+static void handle_batch_signal(int signum) {
+  // Workers receive the signal as well and shut down on their own, just stop starting new ones.
+  batch_interrupted = 1;
+}
+
+BatchRunner::BatchRunner(unsigned int nr_jobs, long time_limit, long memory_limit, const string& output_directory): nr_jobs(std::max(1u, nr_jobs)), time_limit(time_limit), memory_limit(memory_limit), output_directory(output_directory) {}
+
+double BatchRunner::now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+vector<string> BatchRunner::readInstances(const string& path) {
+  vector<string> instances;
+  std::error_code error;
+  if (fs::is_directory(path, error)) {
+    for (auto& entry: fs::directory_iterator(path, error)) {
+      if (entry.is_regular_file()) {
+        instances.push_back(entry.path().string());
+      }
+    }
+  } else {
+    std::ifstream manifest(path);
+    string line;
+    while (std::getline(manifest, line)) {
+      line.erase(remove_if(line.begin(), line.end(), [] (char c) { return c == '\r'; }), line.end());
+      if (line.length() > 0 && line.front() != '#') {
+        instances.push_back(line);
+      }
+    }
+  }
+  // Start with the largest instances so that long jobs don't end up at the tail of the batch. Sizes are looked up once,
+  // missing files count as empty.
+  vector<std::pair<uintmax_t, string>> sized_instances;
+  for (auto& instance: instances) {
+    auto size = fs::file_size(instance, error);
+    sized_instances.emplace_back(error ? 0 : size, std::move(instance));
+  }
+  std::stable_sort(sized_instances.begin(), sized_instances.end(), [](const auto& first, const auto& second) {
+    return first.first > second.first;
+  });
+  for (unsigned int i = 0; i < sized_instances.size(); i++) {
+    instances[i] = std::move(sized_instances[i].second);
+  }
+  return instances;
+}
+
+BatchJob BatchRunner::makeJob(const string& instance, const string& output_extension) {
+  string base_name = fs::path(instance).filename().string();
+  string name = base_name;
+  for (auto suffix = used_names.size(); used_names.count(name) > 0; suffix++) {
+    name = base_name + "." + std::to_string(suffix);
+  }
+  used_names.insert(name);
+  auto base = (fs::path(output_directory) / name).string();
+  return {instance, base + output_extension, base + ".stats.json", base + ".log", now()};
+}
+
+pid_t BatchRunner::startWorker(const BatchJob& job, const instance_processor& process) {
+  pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+  // Worker: apply limits, redirect log output, and process the instance.
+  if (time_limit > 0) {
+    // The soft limit raises SIGXCPU (handled gracefully), the hard limit kills the worker.
+    struct rlimit cpu_limit = {rlim_t(time_limit), rlim_t(time_limit + 5)};
+    setrlimit(RLIMIT_CPU, &cpu_limit);
+  }
+  if (memory_limit > 0) {
+    rlim_t bytes = rlim_t(memory_limit) << 20;
+    struct rlimit address_space_limit = {bytes, bytes};
+    setrlimit(RLIMIT_AS, &address_space_limit);
+  }
+  int log_fd = open(job.log_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (log_fd >= 0) {
+    dup2(log_fd, STDERR_FILENO);
+    close(log_fd);
+  }
+  int exit_code = 1;
+  try {
+    exit_code = process(job.instance, job.output_filename, job.stats_filename);
+  }
+  catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+  }
+  std::cout.flush();
+  std::cerr.flush();
+  _exit(exit_code);
+}
+
+void BatchRunner::writeRecord(std::ostream& out, const BatchJob& job, int status, const struct rusage& usage) {
+  string result;
+  int code;
+  if (WIFEXITED(status)) {
+    code = WEXITSTATUS(status);
+    result = (code == 0) ? "ok" : "error";
+  } else {
+    code = WTERMSIG(status);
+    result = "killed";
+  }
+  double cpu_time = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+  out << "{\"instance\": ";
+  Statistics::printString(out, job.instance);
+  out << ", \"result\": \"" << result << "\", " << (WIFEXITED(status) ? "\"exit_code\": " : "\"signal\": ") << code;
+  out << ", \"wall_time\": " << now() - job.start << ", \"cpu_time\": " << cpu_time << ", \"peak_memory_kb\": " << usage.ru_maxrss;
+  out << ", \"output\": ";
+  Statistics::printString(out, job.output_filename);
+  out << ", \"stats\": ";
+  Statistics::printString(out, job.stats_filename);
+  out << ", \"log\": ";
+  Statistics::printString(out, job.log_filename);
+  out << "}" << std::endl;
+}
+
+void BatchRunner::writeFailedRecord(std::ostream& out, const BatchJob& job, const string& error) {
+  // The instance was not processed (no worker could be started).
+  out << "{\"instance\": ";
+  Statistics::printString(out, job.instance);
+  out << ", \"result\": \"failed\", \"error\": ";
+  Statistics::printString(out, error);
+  out << "}" << std::endl;
+}
+
+int BatchRunner::run(const vector<string>& instances, const string& output_extension, const instance_processor& process) {
+  std::error_code error;
+  fs::create_directories(output_directory, error);
+  auto results_filename = (fs::path(output_directory) / "results.jsonl").string();
+  std::ofstream results(results_filename);
+  if (!results) {
+    std::cerr << "Error opening file: " << results_filename << std::endl;
+    return 1;
+  }
+  signal(SIGINT, handle_batch_signal);
+  signal(SIGTERM, handle_batch_signal);
+
+  std::unordered_map<pid_t, BatchJob> running;
+  unsigned int next_instance = 0, finished = 0, failed = 0;
+  while ((next_instance < instances.size() && !batch_interrupted) || !running.empty()) {
+    while (running.size() < nr_jobs && next_instance < instances.size() && !batch_interrupted) {
+      auto job = makeJob(instances[next_instance++], output_extension);
+      pid_t pid = startWorker(job, process);
+      if (pid < 0) {
+        string error = strerror(errno);
+        std::cerr << "Could not start worker for " << job.instance << ": " << error << std::endl;
+        writeFailedRecord(results, job, error);
+        failed++;
+        continue;
+      }
+      running.emplace(pid, job);
+    }
+    int status;
+    struct rusage usage;
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    auto it = running.find(pid);
+    if (it == running.end()) {
+      continue;
+    }
+    writeRecord(results, it->second, status, usage);
+    failed += !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    running.erase(it);
+    std::cerr << ++finished << "/" << instances.size() << " instances processed. \r";
+  }
+  std::cerr << std::endl << "Processed " << finished << " instances (" << failed << " failed), results written to " << results_filename << std::endl;
+  return failed > 0 || batch_interrupted;
+}
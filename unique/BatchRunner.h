@@ -0,0 +1,44 @@
+#ifndef BatchRunner_h
+#define BatchRunner_h
+
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <sys/types.h>
+
+using std::string;
+using std::vector;
+
+// Processes an instance given input, output, and statistics filenames, returns an exit code.
+typedef std::function<int(const string&, const string&, const string&)> instance_processor;
+
+struct BatchJob {
+  string instance;
+  string output_filename;
+  string stats_filename;
+  string log_filename;
+  double start;
+};
+
+class BatchRunner {
+public:
+  BatchRunner(unsigned int nr_jobs, long time_limit, long memory_limit, const string& output_directory);
+  int run(const vector<string>& instances, const string& output_extension, const instance_processor& process);
+  static vector<string> readInstances(const string& path);
+
+protected:
+  BatchJob makeJob(const string& instance, const string& output_extension);
+  pid_t startWorker(const BatchJob& job, const instance_processor& process);
+  void writeRecord(std::ostream& out, const BatchJob& job, int status, const struct rusage& usage);
+  void writeFailedRecord(std::ostream& out, const BatchJob& job, const string& error);
+  double now();
+
+  unsigned int nr_jobs;
+  long time_limit;
+  long memory_limit;
+  string output_directory;
+  std::unordered_set<string> used_names;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef ClauseArena_h
+#define ClauseArena_h
+
+#include <cstddef>
+#include <vector>
+
+#include "ClauseSink.h"
+
+using std::vector;
+
+/* A clause stored in a ClauseArena, valid until clauses are added to the arena. */
+template<typename Literal> class ClauseView {
+public:
+  ClauseView(Literal* first, Literal* last): first(first), last(last) {}
+  template<typename Other> ClauseView(const ClauseView<Other>& other): first(other.begin()), last(other.end()) {}
+  Literal* begin() const {
+    return first;
+  }
+  Literal* end() const {
+    return last;
+  }
+  unsigned int size() const {
+    return last - first;
+  }
+  Literal& operator[](unsigned int i) const {
+    return first[i];
+  }
+
+protected:
+  Literal* first;
+  Literal* last;
+};
+
+template<typename Literal> class ClauseIterator {
+public:
+  ClauseIterator(Literal* literals, const size_t* offset): literals(literals), offset(offset) {}
+  ClauseView<Literal> operator*() const {
+    return ClauseView<Literal>(literals + offset[0], literals + offset[1]);
+  }
+  ClauseIterator& operator++() {
+    ++offset;
+    return *this;
+  }
+  bool operator!=(const ClauseIterator& other) const {
+    return offset != other.offset;
+  }
+
+protected:
+  Literal* literals;
+  const size_t* offset;
+};
+
+/*
+  Stores all clauses of a formula in one contiguous literal array, clause i consists of
+  the literals in [offsets[i], offsets[i + 1]). Avoids one allocation per clause.
+*/
+class ClauseArena: public ClauseSink {
+public:
+  ClauseArena(): offsets{0} {}
+  size_t size() const {
+    return offsets.size() - 1;
+  }
+  size_t nrLiterals() const {
+    return literals.size();
+  }
+  void swap(ClauseArena& other) {
+    literals.swap(other.literals);
+    offsets.swap(other.offsets);
+  }
+  void reserve(size_t nr_clauses, size_t nr_literals) {
+    offsets.reserve(nr_clauses + 1);
+    literals.reserve(nr_literals);
+  }
+  // Clauses can also be built literal by literal.
+  void addLiteral(int literal) {
+    literals.push_back(literal);
+  }
+  void closeClause() {
+    offsets.push_back(literals.size());
+  }
+  ClauseView<int> operator[](size_t i) {
+    return ClauseView<int>(literals.data() + offsets[i], literals.data() + offsets[i + 1]);
+  }
+  ClauseView<const int> operator[](size_t i) const {
+    return ClauseView<const int>(literals.data() + offsets[i], literals.data() + offsets[i + 1]);
+  }
+  ClauseIterator<int> begin() {
+    return ClauseIterator<int>(literals.data(), offsets.data());
+  }
+  ClauseIterator<int> end() {
+    return ClauseIterator<int>(literals.data(), offsets.data() + size());
+  }
+  ClauseIterator<const int> begin() const {
+    return ClauseIterator<const int>(literals.data(), offsets.data());
+  }
+  ClauseIterator<const int> end() const {
+    return ClauseIterator<const int>(literals.data(), offsets.data() + size());
+  }
+
+protected:
+  void receiveClause(const int* clause, unsigned int size) override {
+    literals.insert(literals.end(), clause, clause + size);
+    offsets.push_back(literals.size());
+  }
+
+  vector<int> literals;
+  vector<size_t> offsets;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ClauseSink_h
+#define ClauseSink_h
+
+#include <initializer_list>
+#include <vector>
+
+using std::vector;
+
+/* Receives clauses generated gate by gate, so callers decide whether to store, count, or print them. */
+class ClauseSink {
+public:
+  virtual ~ClauseSink() {}
+  void addClause(const int* literals, unsigned int size) {
+    receiveClause(literals, size);
+  }
+  void addClause(const vector<int>& clause) {
+    receiveClause(clause.data(), clause.size());
+  }
+  void addClause(std::initializer_list<int> clause) {
+    receiveClause(clause.begin(), clause.size());
+  }
+
+protected:
+  virtual void receiveClause(const int* literals, unsigned int size) = 0;
+};
+
+class ClauseCounter: public ClauseSink {
+public:
+  ClauseCounter(): nr_clauses(0) {}
+  unsigned long nr_clauses;
+
+protected:
+  void receiveClause(const int*, unsigned int) override {
+    nr_clauses++;
+  }
+};
+
+#endif
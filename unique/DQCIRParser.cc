@@ -2,8 +2,16 @@
 
 DQCIRParser::DQCIRParser(const std::string& filename) {
   std::ifstream file(filename.c_str());
+  parse(file);
+}
+
+DQCIRParser::DQCIRParser(std::istream& in) {
+  parse(in);
+}
+
+void DQCIRParser::parse(std::istream& in) {
   string line;
-  while (std::getline(file, line)) {
+  while (std::getline(in, line)) {
     auto line_with_withspaces = line; // Hack for dependency lines.
     line.erase(remove_if(line.begin(), line.end(), [] (char c) { return isspace(int(c)); }), line.end()); // Remove whitespaces.
     if (line.length() == 0 || line.front() == '#') {
@@ -20,13 +28,13 @@ DQCIRParser::DQCIRParser(const std::string& filename) {
   }
   assert(output_id.size());
   assert(id_to_alias.find(output_id) != id_to_alias.end());
-  std::cerr << "Done parsing " << gates.size() << " gates." << std::endl;
+  endStructuralHashing();
 
   /* Remove redundant gates (optional). */
-  std::cerr << "Removed " << removeRedundant() << " redundant gates." << std::endl;
-};
+  nr_redundant_gates = removeRedundant();
+}
 
-void DQCIRParser::doWriteQCIR(std::ostream& out) {
+void DQCIRParser::doWriteQCIR(OutputBuffer& out) {
   DQDIMACSParser::doWriteQCIR(out);
 }
 
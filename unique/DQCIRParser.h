@@ -8,9 +8,11 @@
 class DQCIRParser: public DQDIMACSParser, public QCIRParser {
 public:
   DQCIRParser(const std::string& filename);
+  DQCIRParser(std::istream& in);
 
 protected:
-  virtual void doWriteQCIR(std::ostream& out);
+  void parse(std::istream& in);
+  virtual void doWriteQCIR(OutputBuffer& out);
   virtual void doGetDefinitions(Extractor& extractor);
 
 };
@@ -10,8 +10,16 @@ const string DQDIMACSParser::DEPENDENCY_STRING = "d";
 
 DQDIMACSParser::DQDIMACSParser(const string& filename) {
   std::ifstream file(filename.c_str());
+  parse(file);
+}
+
+DQDIMACSParser::DQDIMACSParser(std::istream& in) {
+  parse(in);
+}
+
+void DQDIMACSParser::parse(std::istream& in) {
   string line;
-  while (std::getline(file, line)) {
+  while (std::getline(in, line)) {
     if (line.length() == 0 || line.front() == 'c' || line.front() == 'p') { // Ignore preamble as well.
       continue;
     } else if (startsWith(line, FORALL_STRING) || startsWith(line, EXISTS_STRING)) {
@@ -73,16 +81,22 @@ auto DQDIMACSParser::getDependentExistentialDefinitions(Extractor& extractor) {
 void DQDIMACSParser::doGetDefinitions(Extractor& extractor) {
   auto [defined, definitions] = getOrdinaryExistentialDefinitions(extractor);
   auto [dependent_defined, dependent_definitions] = getDependentExistentialDefinitions(extractor);
-  std::cerr << dependent_defined.size() << " of " << dependency_map.size() << " variables with explicit dependencies uniquely determined." << std::endl;
+  if (verbose) {
+    std::cerr << dependent_defined.size() << " of " << dependency_map.size() << " variables with explicit dependencies uniquely determined." << std::endl;
+  }
 
   defined.insert(defined.end(), std::make_move_iterator(dependent_defined.begin()), std::make_move_iterator(dependent_defined.end()));
   definitions.insert(definitions.end(), std::make_move_iterator(dependent_definitions.begin()), std::make_move_iterator(dependent_definitions.end()));
 
-  float fraction = float(defined.size()) / float(numberVariables(VariableType::Existential));
-  std::cerr << "Found " << defined.size() << " out of " << numberVariables(VariableType::Existential) << " existential variables uniquely determined (" << fraction << ")." << std::endl;
+  if (verbose) {
+    float fraction = float(defined.size()) / float(numberVariables(VariableType::Existential));
+    std::cerr << "Found " << defined.size() << " out of " << numberVariables(VariableType::Existential) << " existential variables uniquely determined (" << fraction << ")." << std::endl;
+  }
 
   if (defined.size() > 0) {
-    std::cerr << "Processing definitions. " << std::endl;
+    if (verbose) {
+      std::cerr << "Processing definitions. " << std::endl;
+    }
     addDefinitions(definitions, defined);
   }
 }
@@ -109,14 +123,14 @@ void DQDIMACSParser::readDependencyBlock(const string& line) {
   reverse_dependency_map[dependencies].push_back(dependent_variable_alias);
 }
 
-void DQDIMACSParser::doWriteQCIR(std::ostream& out) {
+void DQDIMACSParser::doWriteQCIR(OutputBuffer& out) {
   printDQCIRPrefix(out);
   printDependencyBlocks(out);
   printQCIRGates(out);
 }
 
-void DQDIMACSParser::printDQCIRPrefix(std::ostream& out) {
-  out << "#QCIR-G14" << std::endl; // Print "preamble".
+void DQDIMACSParser::printDQCIRPrefix(OutputBuffer& out) {
+  out << "#QCIR-G14" << '\n'; // Print "preamble".
   GateType last_block_type = GateType::None;
   bool first_variable_seen = false;
   for (unsigned i = 1; i < variable_gate_boundary; i++) {
@@ -125,7 +139,7 @@ void DQDIMACSParser::printDQCIRPrefix(std::ostream& out) {
       if (gate.gate_type != last_block_type) { 
         last_block_type = gate.gate_type;
         if (first_variable_seen) {
-          out << ')' << std::endl; // Close last block unless this is the first variable.
+          out << ')' << '\n'; // Close last block unless this is the first variable.
         }
         auto& block_start_string = (gate.gate_type == GateType::Existential) ? QBFParser::EXISTS_STRING : QBFParser::FORALL_STRING;
         out << block_start_string << '(' << gate.gate_id; // "Open" a new quantifier block.
@@ -136,26 +150,29 @@ void DQDIMACSParser::printDQCIRPrefix(std::ostream& out) {
     }
   }
   if (first_variable_seen) { // Close last block (if there were any quantified variables).
-    out << ')' << std::endl; 
+    out << ')' << '\n'; 
   }
-  out << "output(" << output_id << ')' << std::endl;
+  out << "output(" << output_id << ')' << '\n';
 }
 
-void DQDIMACSParser::printDependencyBlocks(std::ostream& out) {
+void DQDIMACSParser::printDependencyBlocks(OutputBuffer& out) {
   for (unsigned alias = 1; alias < variable_gate_boundary; alias++) {
     auto& gate = gates[alias];
     if (gate.gate_type == GateType::Existential && dependency_map.find(alias) != dependency_map.end()) {
       out << DEPENDENCY_STRING << " " << gate.gate_id << " ";
       for (auto& dependency: dependency_map[alias]) {
         auto& gate_dependency = gates[dependency];
-        out << gate_dependency.gate_id << " ";
+        // Skip universals removed by simplification.
+        if (gate_dependency.gate_type == GateType::Universal) {
+          out << gate_dependency.gate_id << " ";
+        }
       }
-      out << "0" << std::endl;
+      out << "0" << '\n';
     }
   }
 }
 
-void DQDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
+void DQDIMACSParser::printQDIMACSPrefix(OutputBuffer& out) {
   GateType last_block_type = GateType::None;
   bool first_variable_seen = false;
   for (unsigned i = 1; i < variable_gate_boundary; i++) {
@@ -164,7 +181,7 @@ void DQDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
       if (gate.gate_type != last_block_type) { 
         last_block_type = gate.gate_type;
         if (first_variable_seen) {
-          out << "0" << std::endl; // Close last block unless this is the first variable.
+          out << "0" << '\n'; // Close last block unless this is the first variable.
         }
         auto block_start_string = (gate.gate_type == GateType::Existential) ? 'e' : 'a';
         out << block_start_string << " ";  // "Open" a new quantifier block.
@@ -183,8 +200,12 @@ void DQDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
     }
   }
   if (and_gates.size() > 0) {
-    if (last_block_type == GateType::Universal) { // Open new quantifier block if necessary.
-      out << "0" << std::endl << "e ";
+    if (last_block_type != GateType::Existential) { // Open new quantifier block if necessary.
+      if (first_variable_seen) {
+        out << "0" << '\n';
+      }
+      out << "e ";
+      first_variable_seen = true;
     }
     for (auto& alias: and_gates) {
       auto& gate = gates[alias];
@@ -192,7 +213,7 @@ void DQDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
     }
   }
   if (first_variable_seen) {  // Close last quantifier block.
-    out << "0" << std::endl;
+    out << "0" << '\n';
   }
   // Finally, print explicit dependencies.
   printDependencyBlocks(out);
@@ -28,15 +28,17 @@ class DQDIMACSParser: virtual public QDIMACSParser {
 
 public:
   DQDIMACSParser(const string& filename);
+  DQDIMACSParser(std::istream& in);
 
 protected:
   DQDIMACSParser();
-  virtual void doWriteQCIR(std::ostream& out);
+  void parse(std::istream& in);
+  virtual void doWriteQCIR(OutputBuffer& out);
   virtual void doGetDefinitions(Extractor& extractor);
-  virtual void printQDIMACSPrefix(std::ostream& out);
+  virtual void printQDIMACSPrefix(OutputBuffer& out);
   void readDependencyBlock(const string& line);
-  void printDependencyBlocks(std::ostream& out);
-  void printDQCIRPrefix(std::ostream& out);
+  void printDependencyBlocks(OutputBuffer& out);
+  void printDQCIRPrefix(OutputBuffer& out);
   auto getExistentialQuerySets();
   auto getOrdinaryExistentialDefinitions(Extractor& extractor);
   auto getDependentExistentialDefinitions(Extractor& extractor);
@@ -0,0 +1,304 @@
+#include "DefinabilityCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <assert.h>
+
+DefinabilityCache::DefinabilityCache(const string& filename): filename(filename), nr_hits(0), nr_misses(0) {
+  // A missing file is an empty cache, it is created on the first store.
+  std::ifstream in(filename);
+  string line;
+  unsigned int nr_skipped = 0;
+  while (std::getline(in, line)) {
+    if (!line.empty() && !readEntry(line)) {
+      nr_skipped++;
+    }
+  }
+  std::cerr << "Read " << entries.size() << " cached results from " << filename << "." << std::endl;
+  if (nr_skipped > 0) {
+    std::cerr << "Skipped " << nr_skipped << " malformed cache entries." << std::endl;
+  }
+}
+
+DefinabilityCache::~DefinabilityCache() {
+  if (!new_entries.empty()) {
+    // A single write, so that runs sharing the file do not interleave within a line.
+    std::ofstream out(filename, std::ios::app);
+    out.write(new_entries.data(), new_entries.size());
+    if (!out) {
+      std::cerr << "Could not write cache file " << filename << "." << std::endl;
+    }
+  }
+}
+
+bool DefinabilityCache::readEntry(const string& line) {
+  std::istringstream in(line);
+  CacheKey key;
+  CachedDefinition result;
+  unsigned int nr_literals;
+  if (!(in >> key.first >> key.second >> result.defined)) {
+    return false;
+  }
+  result.nr_inputs = 0;
+  if (result.defined) {
+    if (!(in >> result.nr_inputs >> nr_literals) || nr_literals % 2 == 0) {
+      return false;
+    }
+    result.literals.resize(nr_literals);
+    for (unsigned int i = 0; i < nr_literals; i++) {
+      if (!(in >> result.literals[i])) {
+        return false;
+      }
+      // Gates only use nodes before them.
+      if ((result.literals[i] >> 1) > result.nr_inputs + i / 2) {
+        return false;
+      }
+    }
+  }
+  entries[key] = std::move(result);
+  return true;
+}
+
+const CachedDefinition* DefinabilityCache::find(const CacheKey& key) {
+  // Entries are never removed or changed, so the result stays valid after unlocking.
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    nr_misses++;
+    return nullptr;
+  }
+  nr_hits++;
+  return &it->second;
+}
+
+void DefinabilityCache::store(const CacheKey& key, const CachedDefinition& result) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!entries.emplace(key, result).second) {
+    return;
+  }
+  new_entries += std::to_string(key.first) + " " + std::to_string(key.second) + " " + std::to_string(int(result.defined));
+  if (result.defined) {
+    new_entries += " " + std::to_string(result.nr_inputs) + " " + std::to_string(result.literals.size());
+    for (auto literal: result.literals) {
+      new_entries += " " + std::to_string(literal);
+    }
+  }
+  new_entries += '\n';
+}
+
+unsigned int DefinabilityCache::numberHits() {
+  return nr_hits;
+}
+
+unsigned int DefinabilityCache::numberMisses() {
+  return nr_misses;
+}
+
+uint64_t DefinabilityCache::mix(uint64_t value) {
+  // Finalizer of splitmix64.
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+CacheKey DefinabilityCache::extendKey(const CacheKey& key, int64_t value) {
+  // Two independent 64-bit hashes, collisions of both are negligible.
+  return { mix(key.first + mix(uint64_t(value) + 0x9e3779b97f4a7c15ULL)), mix(key.second ^ mix(uint64_t(value) * 0xd6e8feb86659fd93ULL + 1)) };
+}
+
+CacheKey DefinabilityCache::clauseKey(vector<int>& literals) {
+  std::sort(literals.begin(), literals.end());
+  CacheKey key = { literals.size(), literals.size() };
+  for (auto literal: literals) {
+    key = extendKey(key, literal);
+  }
+  return key;
+}
+
+bool DefinabilityCache::fromCircuit(Aig_Man_t* circuit, int output_index, unsigned int nr_inputs, CachedDefinition& result) {
+  result.defined = true;
+  result.nr_inputs = nr_inputs;
+  result.literals.clear();
+  Aig_ManSetCioIds(circuit);
+  Aig_Obj_t* output = Aig_ManCo(circuit, output_index);
+  Vec_Ptr_t* vNodes = Aig_ManDfsNodes(circuit, &output, 1);
+  unsigned int next_node = nr_inputs + 1;
+  bool inputs_available = true;
+  auto literal = [&](Aig_Obj_t* node, int complemented) {
+    unsigned int index;
+    if (Aig_ObjIsConst1(node)) {
+      index = 0;
+    } else if (Aig_ObjIsCi(node)) {
+      index = Aig_ObjCioId(node) + 1;
+      inputs_available = inputs_available && Aig_ObjCioId(node) < nr_inputs;
+    } else {
+      index = node->iData;
+    }
+    return 2 * index + unsigned(complemented);
+  };
+  Aig_Obj_t* pObj;
+  int i;
+  Vec_PtrForEachEntry(Aig_Obj_t*, vNodes, pObj, i) {
+    if (!Aig_ObjIsNode(pObj)) {
+      continue;
+    }
+    result.literals.push_back(literal(Aig_ObjFanin0(pObj), Aig_ObjFaninC0(pObj)));
+    result.literals.push_back(literal(Aig_ObjFanin1(pObj), Aig_ObjFaninC1(pObj)));
+    pObj->iData = next_node++;
+  }
+  result.literals.push_back(literal(Aig_ObjFanin0(output), Aig_ObjFaninC0(output)));
+  Vec_PtrFree(vNodes);
+  Aig_ManCleanCioIds(circuit);
+  return inputs_available;
+}
+
+Aig_Man_t* DefinabilityCache::toCircuit(const vector<const CachedDefinition*>& definitions, unsigned int nr_inputs) {
+  Aig_Man_t* circuit = Aig_ManStart(1 << 10);
+  vector<Aig_Obj_t*> inputs;
+  for (unsigned int i = 0; i < nr_inputs; i++) {
+    inputs.push_back(Aig_ObjCreateCi(circuit));
+  }
+  if (nr_inputs == 0) {
+    // Dummy input, like the circuits of the solver.
+    Aig_ObjCreateCi(circuit);
+  }
+  vector<Aig_Obj_t*> nodes;
+  for (auto definition: definitions) {
+    assert(definition->defined && definition->nr_inputs <= nr_inputs);
+    nodes.assign(1, Aig_ManConst1(circuit));
+    nodes.insert(nodes.end(), inputs.begin(), inputs.begin() + definition->nr_inputs);
+    auto node = [&nodes](unsigned int literal) {
+      return Aig_NotCond(nodes[literal >> 1], literal & 1);
+    };
+    auto& literals = definition->literals;
+    for (unsigned int j = 0; j + 1 < literals.size(); j += 2) {
+      nodes.push_back(Aig_And(circuit, node(literals[j]), node(literals[j + 1])));
+    }
+    Aig_ObjCreateCo(circuit, node(literals.back()));
+  }
+  return circuit;
+}
+
+bool DefinabilityCache::remapInputs(const CachedDefinition& definition, const vector<int>& positions, unsigned int nr_inputs, CachedDefinition& result) {
+  assert(definition.defined && positions.size() == definition.nr_inputs);
+  result.defined = true;
+  result.nr_inputs = nr_inputs;
+  result.literals.clear();
+  for (auto literal: definition.literals) {
+    unsigned int node = literal >> 1;
+    if (node > definition.nr_inputs) {
+      // Gates keep their order after the inputs.
+      node = node - definition.nr_inputs + nr_inputs;
+    } else if (node > 0) {
+      if (positions[node - 1] < 0) {
+        return false;
+      }
+      node = positions[node - 1] + 1;
+    }
+    result.literals.push_back(2 * node + (literal & 1));
+  }
+  return true;
+}
+
+QueryCones::QueryCones(ClauseArena& formula, const vector<int>& original_variables): formula(formula), original_variables(original_variables), occurrences(original_variables.size() + 1), variable_marks(original_variables.size() + 1, 0), clause_marks(formula.size(), 0), mark(0) {
+  vector<int> literals;
+  for (size_t i = 0; i < formula.size(); i++) {
+    literals.clear();
+    for (auto literal: formula[i]) {
+      occurrences[abs(literal)].push_back(i);
+      literals.push_back(literal > 0 ? original_variables[literal - 1] : -original_variables[-literal - 1]);
+    }
+    clause_keys.push_back(DefinabilityCache::clauseKey(literals));
+  }
+}
+
+CacheKey QueryCones::coneKey(int variable, const vector<int>& shared_position, vector<int>& cone_shared_variables) {
+  // Clause keys are summed, as for whole formulas.
+  CacheKey key = { 0, 0 };
+  unsigned int nr_clauses = 0;
+  cone_shared_variables.clear();
+  mark++;
+  vector<int> stack = { variable };
+  variable_marks[variable] = mark;
+  while (!stack.empty()) {
+    auto current = stack.back();
+    stack.pop_back();
+    for (auto clause: occurrences[current]) {
+      if (clause_marks[clause] == mark) {
+        continue;
+      }
+      clause_marks[clause] = mark;
+      key.first += clause_keys[clause].first;
+      key.second += clause_keys[clause].second;
+      nr_clauses++;
+      for (auto literal: formula[clause]) {
+        auto next = abs(literal);
+        if (variable_marks[next] == mark) {
+          continue;
+        }
+        variable_marks[next] = mark;
+        if (shared_position[next] >= 0) {
+          cone_shared_variables.push_back(next);
+        } else {
+          stack.push_back(next);
+        }
+      }
+    }
+  }
+  std::sort(cone_shared_variables.begin(), cone_shared_variables.end(), [this](int first, int second) {
+    return original_variables[first - 1] < original_variables[second - 1];
+  });
+  key = DefinabilityCache::extendKey(key, nr_clauses);
+  for (auto shared_variable: cone_shared_variables) {
+    key = DefinabilityCache::extendKey(key, original_variables[shared_variable - 1]);
+  }
+  key = DefinabilityCache::extendKey(key, 0);
+  return DefinabilityCache::extendKey(key, original_variables[variable - 1]);
+}
+
+bool QueryCones::holds(int variable, const CachedDefinition& definition, const vector<int>& input_variables, int conflict_limit) {
+  if (!checker) {
+    // Variables of the formula keep their numbers, variable 0 is the constant true.
+    checker = std::make_unique<Minisat::Solver>();
+    for (size_t i = 0; i <= original_variables.size(); i++) {
+      checker->newVar();
+    }
+    checker->addClause(Minisat::mkLit(0));
+    Minisat::vec<Minisat::Lit> clause;
+    for (auto formula_clause: formula) {
+      clause.clear();
+      for (auto literal: formula_clause) {
+        clause.push(Minisat::mkLit(abs(literal), literal < 0));
+      }
+      checker->addClause(clause);
+    }
+  }
+  // The gates are encoded with fresh variables, the check is guarded by a selector that is disabled afterwards.
+  vector<Minisat::Lit> nodes = { Minisat::mkLit(0) };
+  for (unsigned int i = 0; i < definition.nr_inputs; i++) {
+    nodes.push_back(Minisat::mkLit(input_variables[i]));
+  }
+  auto node = [&nodes](unsigned int literal) {
+    return nodes[literal >> 1] ^ bool(literal & 1);
+  };
+  auto& literals = definition.literals;
+  for (unsigned int j = 0; j + 1 < literals.size(); j += 2) {
+    auto gate = Minisat::mkLit(checker->newVar());
+    checker->addClause(~gate, node(literals[j]));
+    checker->addClause(~gate, node(literals[j + 1]));
+    checker->addClause(gate, ~node(literals[j]), ~node(literals[j + 1]));
+    nodes.push_back(gate);
+  }
+  auto output = node(literals.back());
+  auto selector = Minisat::mkLit(checker->newVar());
+  checker->addClause(~selector, Minisat::mkLit(variable), output);
+  checker->addClause(~selector, ~Minisat::mkLit(variable), ~output);
+  Minisat::vec<Minisat::Lit> assumptions;
+  assumptions.push(selector);
+  checker->setConfBudget(conflict_limit);
+  auto result = checker->solveLimited(assumptions);
+  checker->addClause(~selector);
+  return result == l_False;
+}
@@ -0,0 +1,123 @@
+#ifndef DefinabilityCache_h
+#define DefinabilityCache_h
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "minisat/core/Solver.h"
+
+#include "InterpolatingSolver.h"
+#include "ClauseArena.h"
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::unordered_map;
+
+using namespace avy::abc;
+
+struct CacheKey {
+  uint64_t first;
+  uint64_t second;
+
+  bool operator==(const CacheKey& other) const {
+    return first == other.first && second == other.second;
+  }
+};
+
+struct CacheKeyHash {
+  size_t operator()(const CacheKey& key) const {
+    return key.first;
+  }
+};
+
+/*
+  Result of a definability check. A definition is stored as a small AIG over the first nr_inputs shared
+  variables: literals are 2 * node + complement, node 0 is constant true, nodes 1 to nr_inputs are the
+  shared variables (by position), every following node is an AND gate given by a pair of literals. The
+  last literal is the output.
+*/
+struct CachedDefinition {
+  bool defined;
+  unsigned int nr_inputs;
+  vector<unsigned int> literals;
+};
+
+/*
+  Definability results that persist across runs, kept in a text file with one result per line. Entries
+  are only added, new ones are appended to the file when the cache is destroyed. Lines that cannot be
+  read (e.g., from an interrupted run) are skipped. Lookups and stores may come from several threads.
+*/
+class DefinabilityCache {
+public:
+  DefinabilityCache(const string& filename);
+  ~DefinabilityCache();
+  DefinabilityCache(const DefinabilityCache&) = delete;
+  DefinabilityCache& operator=(const DefinabilityCache&) = delete;
+  const CachedDefinition* find(const CacheKey& key);
+  void store(const CacheKey& key, const CachedDefinition& result);
+  unsigned int numberHits();
+  unsigned int numberMisses();
+
+  static CacheKey extendKey(const CacheKey& key, int64_t value);
+  // Key of a clause, independent of the order of its literals (which are sorted).
+  static CacheKey clauseKey(vector<int>& literals);
+  // Returns false if the output depends on an input at position nr_inputs or higher.
+  static bool fromCircuit(Aig_Man_t* circuit, int output_index, unsigned int nr_inputs, CachedDefinition& result);
+  // Circuit with one output per definition and nr_inputs inputs, owned by the caller.
+  static Aig_Man_t* toCircuit(const vector<const CachedDefinition*>& definitions, unsigned int nr_inputs);
+  // Moves input i of a definition to position positions[i] of nr_inputs inputs. Returns false if the definition
+  // depends on an input without a position (-1).
+  static bool remapInputs(const CachedDefinition& definition, const vector<int>& positions, unsigned int nr_inputs, CachedDefinition& result);
+
+protected:
+  bool readEntry(const string& line);
+  static uint64_t mix(uint64_t value);
+
+  string filename;
+  unordered_map<CacheKey, CachedDefinition, CacheKeyHash> entries;
+  string new_entries;
+  std::mutex mutex;
+  unsigned int nr_hits;
+  unsigned int nr_misses;
+};
+
+/*
+  Cache keys of the queries on one component of a formula. The cone of a query variable consists of the clauses
+  reachable from it through variables that are not shared. The rest of the formula only constrains the cone through
+  its shared variables, so the key of a query covers the clauses of the cone, its shared variables and the query
+  variable, all over the original variables. It stays the same when parts of the formula outside of the cone change
+  or the component is numbered differently.
+
+  The constraints outside of the cone can still make a definition that was found on another formula wrong, so cached
+  definitions are checked on this formula before they are used. A variable cached as not defined is not checked, it
+  may be defined on this formula because of constraints on the shared variables of its cone.
+*/
+class QueryCones {
+public:
+  // Variables are local to the component, original_variables[v - 1] is the original variable of v.
+  QueryCones(ClauseArena& formula, const vector<int>& original_variables);
+  // Key of the cone of the variable, where shared_position[v] is -1 for variables that are not shared. Returns the
+  // shared variables of the cone, ordered by their original variables (the inputs of cached definitions).
+  CacheKey coneKey(int variable, const vector<int>& shared_position, vector<int>& cone_shared_variables);
+  // Whether the definition (over input_variables) holds on all models of the formula, decided within the limit.
+  bool holds(int variable, const CachedDefinition& definition, const vector<int>& input_variables, int conflict_limit);
+
+protected:
+  ClauseArena& formula;
+  const vector<int>& original_variables;
+  vector<CacheKey> clause_keys;
+  vector<vector<unsigned int>> occurrences;
+  // Marks of the current cone search.
+  vector<unsigned int> variable_marks;
+  vector<unsigned int> clause_marks;
+  unsigned int mark;
+  // Loaded with the formula on the first check.
+  unique_ptr<Minisat::Solver> checker;
+};
+
+#endif
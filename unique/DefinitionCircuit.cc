@@ -0,0 +1,218 @@
+#include "DefinitionCircuit.h"
+
+#include <assert.h>
+
+DefinitionCircuit::DefinitionCircuit(): combined(Aig_ManStart(1 << 10)) {}
+
+DefinitionCircuit::~DefinitionCircuit() {
+  Aig_ManStop(combined);
+}
+
+Aig_Obj_t* DefinitionCircuit::getVariableNode(int variable) {
+  auto it = variable_nodes.find(variable);
+  if (it != variable_nodes.end()) {
+    return it->second;
+  }
+  // Variable without definition, becomes an input.
+  auto input_node = Aig_ObjCreateCi(combined);
+  inputs.push_back(variable);
+  variable_nodes[variable] = input_node;
+  return input_node;
+}
+
+Aig_Obj_t* DefinitionCircuit::getCopy(Aig_Obj_t* circuit_node, const vector<int>& input_variables) {
+  // Inputs are resolved on first use, at that point all definitions they depend on are known.
+  if (circuit_node->pData == nullptr && Aig_ObjIsCi(circuit_node)) {
+    auto input_index = Aig_ObjCioId(circuit_node);
+    if (input_index < input_variables.size()) {
+      circuit_node->pData = getVariableNode(input_variables[input_index]);
+    } else {
+      // Dummy input of a circuit without inputs.
+      circuit_node->pData = Aig_ManConst0(combined);
+    }
+  }
+  assert(circuit_node->pData != nullptr);
+  return static_cast<Aig_Obj_t*>(circuit_node->pData);
+}
+
+void DefinitionCircuit::copyCone(Aig_Obj_t* root, const vector<int>& input_variables) {
+  // Iterative post-order traversal, nodes copied for earlier outputs are reused.
+  vector<Aig_Obj_t*> stack = { root };
+  while (!stack.empty()) {
+    auto node = stack.back();
+    if (node->pData != nullptr || Aig_ObjIsCi(node)) {
+      stack.pop_back();
+      continue;
+    }
+    bool fanins_copied = true;
+    for (auto fanin: { Aig_ObjFanin0(node), Aig_ObjFanin1(node) }) {
+      if (fanin->pData == nullptr && !Aig_ObjIsCi(fanin)) {
+        stack.push_back(fanin);
+        fanins_copied = false;
+      }
+    }
+    if (fanins_copied) {
+      auto first_input = Aig_NotCond(getCopy(Aig_ObjFanin0(node), input_variables), Aig_ObjFaninC0(node));
+      auto second_input = Aig_NotCond(getCopy(Aig_ObjFanin1(node), input_variables), Aig_ObjFaninC1(node));
+      node->pData = Aig_And(combined, first_input, second_input);
+      stack.pop_back();
+    }
+  }
+}
+
+void DefinitionCircuit::addOutput(int variable, Aig_Obj_t* node) {
+  // An input for the variable may already exist, it stays in place until substituted by substituteInputs.
+  [[maybe_unused]] bool added = defined_variables.insert(variable).second;
+  assert(added);
+  variable_nodes[variable] = node;
+  outputs.push_back(variable);
+}
+
+void DefinitionCircuit::addCircuit(Aig_Man_t* circuit, const vector<int>& defined, const vector<int>& input_variables) {
+  assert(Aig_ManCoNum(circuit) == defined.size());
+  Aig_ManCleanData(circuit);
+  Aig_ManSetCioIds(circuit);
+  Aig_ManConst1(circuit)->pData = Aig_ManConst1(combined);
+  Aig_Obj_t* pObj;
+  int i;
+  // Copy outputs one at a time, in the order the variables were defined.
+  Aig_ManForEachCo(circuit, pObj, i) {
+    copyCone(Aig_ObjFanin0(pObj), input_variables);
+    addOutput(defined[i], Aig_NotCond(getCopy(Aig_ObjFanin0(pObj), input_variables), Aig_ObjFaninC0(pObj)));
+  }
+  Aig_ManCleanCioIds(circuit);
+}
+
+void DefinitionCircuit::append(DefinitionCircuit& other) {
+  // Equivalent to adding the circuits of other in the order they were added to it. Inputs of other are variables
+  // it had no definition for, they are resolved first and in order, as adding the circuits would have done.
+  Aig_ManCleanData(other.combined);
+  Aig_ManSetCioIds(other.combined);
+  Aig_ManConst1(other.combined)->pData = Aig_ManConst1(combined);
+  for (unsigned i = 0; i < other.inputs.size(); i++) {
+    Aig_ManCi(other.combined, i)->pData = getVariableNode(other.inputs[i]);
+  }
+  for (auto variable: other.outputs) {
+    auto node = other.variable_nodes[variable];
+    copyCone(Aig_Regular(node), other.inputs);
+    addOutput(variable, Aig_NotCond(getCopy(Aig_Regular(node), other.inputs), Aig_IsComplement(node)));
+  }
+  Aig_ManCleanCioIds(other.combined);
+}
+
+Aig_Man_t* DefinitionCircuit::substituteInputs(vector<int>& resolved_inputs, vector<Aig_Obj_t*>& resolved_outputs) {
+  // Copies the outputs to a new AIG in which inputs of variables that were defined after they were used are replaced
+  // by their definitions. Other inputs keep their order.
+  Aig_Man_t* resolved = Aig_ManStart(Aig_ManObjNumMax(combined));
+  Aig_ManCleanData(combined);
+  Aig_ManSetCioIds(combined);
+  Aig_ManConst1(combined)->pData = Aig_ManConst1(resolved);
+  Aig_Obj_t* pObj;
+  int i;
+  Aig_ManForEachCi(combined, pObj, i) {
+    if (defined_variables.count(inputs[i]) == 0) {
+      pObj->pData = Aig_ObjCreateCi(resolved);
+      resolved_inputs.push_back(inputs[i]);
+    }
+  }
+  // Iterative post-order traversal, the definition of a substituted input is treated as its only fanin.
+  vector<bool> substituting(Aig_ManObjNumMax(combined), false);
+  vector<Aig_Obj_t*> stack;
+  for (auto variable: outputs) {
+    stack.push_back(Aig_Regular(variable_nodes[variable]));
+    while (!stack.empty()) {
+      auto node = stack.back();
+      if (node->pData != nullptr) {
+        stack.pop_back();
+      } else if (Aig_ObjIsCi(node)) {
+        auto definition = variable_nodes[inputs[Aig_ObjCioId(node)]];
+        if (Aig_Regular(definition)->pData != nullptr) {
+          node->pData = Aig_NotCond(static_cast<Aig_Obj_t*>(Aig_Regular(definition)->pData), Aig_IsComplement(definition));
+          stack.pop_back();
+        } else {
+          // Definitions only use variables defined before them or without definition, so there are no cycles.
+          assert(!substituting[Aig_ObjId(node)]);
+          substituting[Aig_ObjId(node)] = true;
+          stack.push_back(Aig_Regular(definition));
+        }
+      } else {
+        bool fanins_copied = true;
+        for (auto fanin: { Aig_ObjFanin0(node), Aig_ObjFanin1(node) }) {
+          if (fanin->pData == nullptr) {
+            stack.push_back(fanin);
+            fanins_copied = false;
+          }
+        }
+        if (fanins_copied) {
+          auto first_input = Aig_NotCond(static_cast<Aig_Obj_t*>(Aig_ObjFanin0(node)->pData), Aig_ObjFaninC0(node));
+          auto second_input = Aig_NotCond(static_cast<Aig_Obj_t*>(Aig_ObjFanin1(node)->pData), Aig_ObjFaninC1(node));
+          node->pData = Aig_And(resolved, first_input, second_input);
+          stack.pop_back();
+        }
+      }
+    }
+    auto node = variable_nodes[variable];
+    resolved_outputs.push_back(Aig_NotCond(static_cast<Aig_Obj_t*>(Aig_Regular(node)->pData), Aig_IsComplement(node)));
+  }
+  Aig_ManCleanCioIds(combined);
+  return resolved;
+}
+
+void DefinitionCircuit::writeDelta(OutputBuffer& out, unsigned int delta) {
+  while (delta & ~0x7f) {
+    out << char((delta & 0x7f) | 0x80);
+    delta >>= 7;
+  }
+  out << char(delta);
+}
+
+void DefinitionCircuit::writeAIGER(OutputBuffer& out, const std::function<string(int)>& variable_name) {
+  // Binary AIGER: inputs are numbered 1..I, AND gates follow in topological order.
+  vector<int> resolved_inputs;
+  vector<Aig_Obj_t*> resolved_outputs;
+  Aig_Man_t* resolved = substituteInputs(resolved_inputs, resolved_outputs);
+  vector<Aig_Obj_t*> output_nodes;
+  for (auto node: resolved_outputs) {
+    output_nodes.push_back(Aig_Regular(node));
+  }
+  Vec_Ptr_t* vNodes = Aig_ManDfsNodes(resolved, output_nodes.data(), output_nodes.size());
+  vector<unsigned int> index(Aig_ManObjNumMax(resolved), 0);
+  Aig_Obj_t* pObj;
+  int i;
+  Aig_ManForEachCi(resolved, pObj, i) {
+    index[Aig_ObjId(pObj)] = i + 1;
+  }
+  Vec_PtrForEachEntry(Aig_Obj_t*, vNodes, pObj, i) {
+    index[Aig_ObjId(pObj)] = resolved_inputs.size() + i + 1;
+  }
+  auto literal = [&index](Aig_Obj_t* node) {
+    auto regular_node = Aig_Regular(node);
+    unsigned int regular_literal = Aig_ObjIsConst1(regular_node) ? 1 : 2 * index[Aig_ObjId(regular_node)];
+    return regular_literal ^ unsigned(Aig_IsComplement(node));
+  };
+  unsigned int nr_ands = Vec_PtrSize(vNodes);
+  out << "aig " << resolved_inputs.size() + nr_ands << ' ' << resolved_inputs.size() << " 0 " << outputs.size() << ' ' << nr_ands << '\n';
+  for (auto node: resolved_outputs) {
+    out << literal(node) << '\n';
+  }
+  Vec_PtrForEachEntry(Aig_Obj_t*, vNodes, pObj, i) {
+    unsigned int lhs = 2 * index[Aig_ObjId(pObj)];
+    unsigned int rhs0 = literal(Aig_ObjChild0(pObj));
+    unsigned int rhs1 = literal(Aig_ObjChild1(pObj));
+    if (rhs0 < rhs1) {
+      std::swap(rhs0, rhs1);
+    }
+    assert(lhs > rhs0);
+    writeDelta(out, lhs - rhs0);
+    writeDelta(out, rhs0 - rhs1);
+  }
+  Vec_PtrFree(vNodes);
+  Aig_ManStop(resolved);
+  for (unsigned j = 0; j < resolved_inputs.size(); j++) {
+    out << 'i' << j << ' ' << variable_name(resolved_inputs[j]) << '\n';
+  }
+  for (unsigned j = 0; j < outputs.size(); j++) {
+    out << 'o' << j << ' ' << variable_name(outputs[j]) << '\n';
+  }
+  out << "c\nDefinitions extracted by Unique.\n";
+}
@@ -0,0 +1,52 @@
+#ifndef DefinitionCircuit_h
+#define DefinitionCircuit_h
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "InterpolatingSolver.h"
+#include "OutputBuffer.h"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+using std::unordered_set;
+
+using namespace avy::abc;
+
+/*
+  Collects the circuits returned by the interpolating solver in a single AIG. Inputs of a
+  circuit that are defined by an earlier output are replaced by that output's function.
+  A variable can also be used as an input before it is defined (by a later pass or round),
+  such inputs are substituted when the AIGER file is written. So the outputs (defined
+  variables) only depend on variables without a definition.
+*/
+class DefinitionCircuit {
+public:
+  DefinitionCircuit();
+  ~DefinitionCircuit();
+  DefinitionCircuit(const DefinitionCircuit&) = delete;
+  DefinitionCircuit& operator=(const DefinitionCircuit&) = delete;
+  void addCircuit(Aig_Man_t* circuit, const vector<int>& defined, const vector<int>& input_variables);
+  void append(DefinitionCircuit& other);
+  void writeAIGER(OutputBuffer& out, const std::function<string(int)>& variable_name);
+
+protected:
+  Aig_Obj_t* getVariableNode(int variable);
+  void copyCone(Aig_Obj_t* root, const vector<int>& input_variables);
+  Aig_Obj_t* getCopy(Aig_Obj_t* circuit_node, const vector<int>& input_variables);
+  void addOutput(int variable, Aig_Obj_t* node);
+  Aig_Man_t* substituteInputs(vector<int>& resolved_inputs, vector<Aig_Obj_t*>& resolved_outputs);
+  static void writeDelta(OutputBuffer& out, unsigned int delta);
+
+  Aig_Man_t* combined;
+  unordered_map<int, Aig_Obj_t*> variable_nodes;
+  vector<int> inputs;
+  vector<int> outputs;
+  unordered_set<int> defined_variables;
+};
+
+#endif
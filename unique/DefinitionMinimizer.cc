@@ -0,0 +1,236 @@
+#include "DefinitionMinimizer.h"
+
+#include <algorithm>
+#include <map>
+#include <stdlib.h>
+
+DefinitionMinimizer::DefinitionMinimizer(ClauseArena& formula, int max_variable_int, int conflict_limit): conflict_limit(conflict_limit), max_variable_int(max_variable_int), models(max_variable_int + 1), nr_models(0) {
+  // Variables of the matrix keep their numbers, variable 0 is the constant true.
+  for (int variable = 0; variable <= max_variable_int; variable++) {
+    solver.newVar();
+  }
+  true_variable = 0;
+  solver.addClause(Minisat::mkLit(true_variable));
+  Minisat::vec<Minisat::Lit> clause;
+  for (auto formula_clause: formula) {
+    clause.clear();
+    for (auto literal: formula_clause) {
+      clause.push(Minisat::mkLit(abs(literal), literal < 0));
+    }
+    solver.addClause(clause);
+  }
+  // Random phases give more diverse models, and thus fewer spurious candidates.
+  solver.rnd_pol = true;
+  Minisat::vec<Minisat::Lit> no_assumptions;
+  for (unsigned int i = 0; i < INITIAL_MODELS; i++) {
+    solver.setConfBudget(conflict_limit);
+    if (solver.solveLimited(no_assumptions) != l_True) {
+      break;
+    }
+    addModel();
+  }
+}
+
+bool DefinitionMinimizer::addModel() {
+  if (nr_models == MAX_MODELS) {
+    return false;
+  }
+  if (nr_models % 64 == 0) {
+    for (auto& model_words: models) {
+      model_words.push_back(0);
+    }
+  }
+  for (int variable = 0; variable <= max_variable_int; variable++) {
+    if (solver.modelValue(variable) == l_True) {
+      models[variable].back() |= uint64_t(1) << (nr_models % 64);
+    }
+  }
+  nr_models++;
+  return true;
+}
+
+Minisat::Lit DefinitionMinimizer::nodeLiteral(Aig_Obj_t* node) {
+  auto literal = Minisat::mkLit(node_variables[Aig_ObjId(Aig_Regular(node))]);
+  return Aig_IsComplement(node) ? ~literal : literal;
+}
+
+void DefinitionMinimizer::simulate(vector<Aig_Obj_t*>& nodes) {
+  unsigned int nr_words = (nr_models + 63) / 64;
+  uint64_t last_word_mask = (nr_models % 64) ? (uint64_t(1) << (nr_models % 64)) - 1 : ~uint64_t(0);
+  for (auto node: nodes) {
+    auto& signature = signatures[Aig_ObjId(node)];
+    if (!Aig_ObjIsNode(node)) {
+      // The constant and the inputs take their values from the models.
+      signature = models[node_variables[Aig_ObjId(node)]];
+      continue;
+    }
+    auto& first = signatures[Aig_ObjId(Aig_ObjFanin0(node))];
+    auto& second = signatures[Aig_ObjId(Aig_ObjFanin1(node))];
+    uint64_t first_complement = Aig_ObjFaninC0(node) ? ~uint64_t(0) : 0;
+    uint64_t second_complement = Aig_ObjFaninC1(node) ? ~uint64_t(0) : 0;
+    signature.resize(nr_words);
+    for (unsigned int w = 0; w < nr_words; w++) {
+      signature[w] = (first[w] ^ first_complement) & (second[w] ^ second_complement);
+    }
+    signature.back() &= last_word_mask;
+  }
+}
+
+vector<uint64_t> DefinitionMinimizer::normalizedSignature(Aig_Obj_t* node, bool& complemented) {
+  // Signatures are normalized so that the first model evaluates to false.
+  auto signature = signatures[Aig_ObjId(node)];
+  complemented = signature[0] & 1;
+  if (complemented) {
+    for (auto& word: signature) {
+      word = ~word;
+    }
+    if (nr_models % 64) {
+      signature.back() &= (uint64_t(1) << (nr_models % 64)) - 1;
+    }
+  }
+  return signature;
+}
+
+Minisat::lbool DefinitionMinimizer::implies(Minisat::Lit first, Minisat::Lit second) {
+  Minisat::vec<Minisat::Lit> assumptions;
+  assumptions.push(first);
+  assumptions.push(~second);
+  solver.setConfBudget(conflict_limit);
+  auto result = solver.solveLimited(assumptions);
+  if (result == l_True) {
+    // A counterexample is another model that refines the signatures.
+    addModel();
+  }
+  return result;
+}
+
+Aig_Man_t* DefinitionMinimizer::minimize(Aig_Man_t* circuit, vector<int>& input_variables) {
+  if (nr_models == 0 || input_variables.empty()) {
+    return nullptr;
+  }
+  // The constant and the inputs come first, followed by the AND nodes in topological order.
+  vector<Aig_Obj_t*> nodes;
+  Aig_Obj_t* pObj;
+  int i;
+  int nr_objects = Aig_ManObjNumMax(circuit);
+  node_variables.assign(nr_objects, -1);
+  signatures.assign(nr_objects, {});
+  replacements.assign(nr_objects, nullptr);
+  // Support of a node: one past the position of the last input in its cone (0 for the constant).
+  vector<int> support(nr_objects, 0);
+  nodes.push_back(Aig_ManConst1(circuit));
+  node_variables[Aig_ObjId(Aig_ManConst1(circuit))] = true_variable;
+  Aig_ManForEachCi(circuit, pObj, i) {
+    nodes.push_back(pObj);
+    node_variables[Aig_ObjId(pObj)] = input_variables[i];
+    support[Aig_ObjId(pObj)] = i + 1;
+  }
+  Vec_Ptr_t* vNodes = Aig_ManDfs(circuit, 1);
+  Vec_PtrForEachEntry(Aig_Obj_t*, vNodes, pObj, i) {
+    nodes.push_back(pObj);
+    support[Aig_ObjId(pObj)] = std::max(support[Aig_ObjId(Aig_ObjFanin0(pObj))], support[Aig_ObjId(Aig_ObjFanin1(pObj))]);
+    auto variable = solver.newVar();
+    node_variables[Aig_ObjId(pObj)] = variable;
+    auto output = Minisat::mkLit(variable);
+    auto first = nodeLiteral(Aig_ObjChild0(pObj));
+    auto second = nodeLiteral(Aig_ObjChild1(pObj));
+    Minisat::vec<Minisat::Lit> clause;
+    clause.push(~output);
+    clause.push(first);
+    solver.addClause(clause);
+    clause.clear();
+    clause.push(~output);
+    clause.push(second);
+    solver.addClause(clause);
+    clause.clear();
+    clause.push(output);
+    clause.push(~first);
+    clause.push(~second);
+    solver.addClause(clause);
+  }
+  Vec_PtrFree(vNodes);
+
+  unsigned int nr_replaced = 0;
+  vector<bool> undecided(nr_objects, false);
+  for (unsigned int round = 0; round < MAX_ROUNDS; round++) {
+    simulate(nodes);
+    unsigned int nr_models_before = nr_models;
+    // Maps a normalized signature to the first node with that signature (in normalized phase).
+    std::map<vector<uint64_t>, Aig_Obj_t*> representatives;
+    for (auto node: nodes) {
+      auto id = Aig_ObjId(node);
+      if (replacements[id] != nullptr || undecided[id]) {
+        continue;
+      }
+      bool complemented;
+      auto signature = normalizedSignature(node, complemented);
+      auto it = representatives.find(signature);
+      if (it == representatives.end()) {
+        representatives.emplace(signature, Aig_NotCond(node, complemented));
+        continue;
+      }
+      if (!Aig_ObjIsNode(node)) {
+        // Inputs are never replaced.
+        continue;
+      }
+      if (support[Aig_ObjId(Aig_Regular(it->second))] > support[id]) {
+        // Replacements must not use later inputs than the node. The inputs of a definition are the variables shared
+        // at the time of its query, later inputs include the defined variable itself (and variables defined after it).
+        // The node becomes the representative instead.
+        it->second = Aig_NotCond(node, complemented);
+        continue;
+      }
+      auto node_literal = nodeLiteral(Aig_NotCond(node, complemented));
+      auto representative_literal = nodeLiteral(it->second);
+      auto result = implies(node_literal, representative_literal);
+      if (result == l_False) {
+        result = implies(representative_literal, node_literal);
+      }
+      if (result == l_False) {
+        replacements[id] = Aig_NotCond(it->second, complemented);
+        nr_replaced++;
+      } else if (result == l_Undef) {
+        undecided[id] = true;
+      }
+    }
+    // Without new models the candidates would not change.
+    if (nr_models == nr_models_before) {
+      break;
+    }
+  }
+  if (nr_replaced == 0) {
+    return nullptr;
+  }
+  return rebuild(circuit, nodes);
+}
+
+Aig_Man_t* DefinitionMinimizer::rebuild(Aig_Man_t* circuit, vector<Aig_Obj_t*>& nodes) {
+  Aig_Man_t* minimized = Aig_ManStart(Aig_ManNodeNum(circuit));
+  vector<Aig_Obj_t*> copies(Aig_ManObjNumMax(circuit), nullptr);
+  auto copy = [&copies](Aig_Obj_t* node) {
+    return Aig_NotCond(copies[Aig_ObjId(Aig_Regular(node))], Aig_IsComplement(node));
+  };
+  Aig_Obj_t* pObj;
+  int i;
+  copies[Aig_ObjId(Aig_ManConst1(circuit))] = Aig_ManConst1(minimized);
+  Aig_ManForEachCi(circuit, pObj, i) {
+    copies[Aig_ObjId(pObj)] = Aig_ObjCreateCi(minimized);
+  }
+  for (auto node: nodes) {
+    if (!Aig_ObjIsNode(node)) {
+      continue;
+    }
+    auto id = Aig_ObjId(node);
+    if (replacements[id] != nullptr) {
+      // Representatives precede the nodes they replace.
+      copies[id] = copy(replacements[id]);
+    } else {
+      copies[id] = Aig_And(minimized, copy(Aig_ObjChild0(node)), copy(Aig_ObjChild1(node)));
+    }
+  }
+  Aig_ManForEachCo(circuit, pObj, i) {
+    Aig_ObjCreateCo(minimized, copy(Aig_ObjChild0(pObj)));
+  }
+  Aig_ManCleanup(minimized);
+  return minimized;
+}
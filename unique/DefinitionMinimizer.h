@@ -0,0 +1,55 @@
+#ifndef DefinitionMinimizer_h
+#define DefinitionMinimizer_h
+
+#include <cstdint>
+#include <vector>
+
+#include "minisat/core/Solver.h"
+
+#include "InterpolatingSolver.h"
+#include "ClauseArena.h"
+
+using std::vector;
+
+using namespace avy::abc;
+
+/*
+  Shrinks definition circuits using the matrix as a care set. Assignments to the circuit inputs that do
+  not extend to a model of the matrix are don't-cares, so a node that is constant or equal to an earlier
+  node (up to complement) on all models can be replaced (SAT sweeping under the care set). Candidates are
+  found by simulating models of the matrix, and every replacement is proved by a conflict-limited SAT call.
+  A node is only replaced by a node that does not depend on later inputs, so every output keeps depending
+  only on inputs its original cone depended on (in particular, a definition never uses the variable it defines).
+*/
+class DefinitionMinimizer {
+public:
+  DefinitionMinimizer(ClauseArena& formula, int max_variable_int, int conflict_limit);
+  // Returns a new (smaller) circuit owned by the caller, or nullptr if no node could be replaced.
+  Aig_Man_t* minimize(Aig_Man_t* circuit, vector<int>& input_variables);
+
+protected:
+  Minisat::Lit nodeLiteral(Aig_Obj_t* node);
+  bool addModel();
+  void simulate(vector<Aig_Obj_t*>& nodes);
+  vector<uint64_t> normalizedSignature(Aig_Obj_t* node, bool& complemented);
+  Minisat::lbool implies(Minisat::Lit first, Minisat::Lit second);
+  Aig_Man_t* rebuild(Aig_Man_t* circuit, vector<Aig_Obj_t*>& nodes);
+
+  Minisat::Solver solver;
+  int conflict_limit;
+  int max_variable_int;
+  // Models of the matrix (values of all variables), one bit per model.
+  vector<vector<uint64_t>> models;
+  unsigned int nr_models;
+  // Per object id of the current circuit.
+  vector<Minisat::Var> node_variables;
+  vector<vector<uint64_t>> signatures;
+  vector<Aig_Obj_t*> replacements;
+  Minisat::Var true_variable;
+
+  static const unsigned int MAX_MODELS = 1024;
+  static const unsigned int INITIAL_MODELS = 16;
+  static const unsigned int MAX_ROUNDS = 4;
+};
+
+#endif
@@ -0,0 +1,10 @@
+#include "InterpolationBackend.h"
+#include "MiniSatBackend.h"
+
+unique_ptr<InterpolationBackend> InterpolationBackend::create(BackendType type, int nr_variables, bool decide_failed_queries) {
+  switch (type) {
+    case BackendType::MiniSat:
+    default:
+      return std::make_unique<MiniSatBackend>(nr_variables, decide_failed_queries);
+  }
+}
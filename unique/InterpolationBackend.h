@@ -0,0 +1,43 @@
+#ifndef InterpolationBackend_h
+#define InterpolationBackend_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "InterpolatingSolver.h"
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+
+using namespace avy::abc;
+
+enum class BackendType { MiniSat };
+enum class QueryResult { Defined, NotDefined, Unknown };
+
+/*
+  Solver interface used by the extractor. Clauses are added to partition 1 (A), partition 2 (B),
+  or to both (partition 0), literals are signed integers (as in DIMACS). A query succeeds if the
+  formula is unsatisfiable under the assumptions, in which case the backend records a definition
+  of the query variable in terms of the shared variables. A query is Unknown if it reached the
+  conflict limit (or was interrupted) before finding a counterexample. Backends that cannot tell
+  these cases apart only need to do so if created with decide_failed_queries, otherwise a failed
+  query under a conflict limit may be Unknown. getCircuit returns these definitions as
+  an AIG with one output per successful query and one input per shared variable (in order).
+  Backends signal running out of memory by throwing std::bad_alloc.
+*/
+class InterpolationBackend {
+public:
+  virtual ~InterpolationBackend() {}
+  virtual bool addClause(const vector<int>& clause, int partition = 0) = 0;
+  virtual bool solve() = 0;
+  // A conflict limit of 0 means no limit.
+  virtual QueryResult getInterpolant(int variable, const vector<int>& assumptions, vector<int>& shared_variables, int conflict_limit) = 0;
+  virtual Aig_Man_t* getCircuit(vector<int>& shared_variables, bool compute_interpolants) = 0;
+  virtual void interrupt() = 0;
+
+  static unique_ptr<InterpolationBackend> create(BackendType type, int nr_variables, bool decide_failed_queries = false);
+};
+
+#endif
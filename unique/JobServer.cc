@@ -0,0 +1,239 @@
+#include "JobServer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const vector<string> JobServer::JOB_OPTIONS = {"mode", "conflict-limit", "output-format", "ordering", "ordering-file"};
+
+JobServer::JobServer(const string& socket_path): socket_path(socket_path), server_fd(-1), stop(nullptr) {}
+
+JobServer::~JobServer() {
+  if (server_fd >= 0) {
+    close(server_fd);
+    unlink(socket_path.c_str());
+  }
+}
+
+int JobServer::serve(const job_handler& handler, const volatile sig_atomic_t& stop) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path too long: " << socket_path << std::endl;
+    return 1;
+  }
+  strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socket_path.c_str());
+  if (server_fd < 0 || bind(server_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 || listen(server_fd, 16) < 0) {
+    std::cerr << "Error opening socket: " << socket_path << " (" << strerror(errno) << ")" << std::endl;
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  this->stop = &stop;
+  std::cerr << "Listening on " << socket_path << std::endl;
+  while (!stop) {
+    // Poll with a timeout so that signals are noticed even if accept would be restarted.
+    struct pollfd server_poll = {server_fd, POLLIN, 0};
+    if (poll(&server_poll, 1, 1000) <= 0) {
+      continue;
+    }
+    int connection_fd = accept(server_fd, nullptr, nullptr);
+    if (connection_fd < 0) {
+      continue;
+    }
+    // Reads wait for at most CONNECTION_TIMEOUT (see waitReadable), so do writes to a client that does not read.
+    struct timeval timeout = {CONNECTION_TIMEOUT / 1000, (CONNECTION_TIMEOUT % 1000) * 1000};
+    setsockopt(connection_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    handleConnection(connection_fd, handler);
+    close(connection_fd);
+  }
+  std::cerr << "Shutting down." << std::endl;
+  return 0;
+}
+
+void JobServer::handleConnection(int connection_fd, const job_handler& handler) {
+  read_buffer.clear();
+  job_options options;
+  string line;
+  while (readLine(connection_fd, line)) {
+    std::istringstream line_stream(line);
+    string command, name, value;
+    line_stream >> command;
+    if (command == "option") {
+      line_stream >> name;
+      std::getline(line_stream >> std::ws, value);
+      if (std::find(JOB_OPTIONS.begin(), JOB_OPTIONS.end(), name) == JOB_OPTIONS.end()) {
+        writeAll(connection_fd, "error unknown option " + name + "\n");
+        return;
+      }
+      if (options.size() == MAX_OPTIONS) {
+        writeAll(connection_fd, "error too many options\n");
+        return;
+      }
+      options.emplace_back("--" + name, value);
+    } else if (command == "path" || command == "data") {
+      try {
+        runJob(connection_fd, command, line_stream, options, handler);
+      }
+      catch (std::exception& e) {
+        writeAll(connection_fd, string("error ") + e.what() + "\n");
+      }
+      return;
+    } else if (!command.empty()) {
+      writeAll(connection_fd, "error unknown command " + command + "\n");
+      return;
+    }
+  }
+}
+
+void JobServer::runJob(int connection_fd, const string& command, std::istream& line_stream, const job_options& options, const job_handler& handler) {
+  string value;
+  std::getline(line_stream >> std::ws, value);
+  unique_ptr<std::istream> input;
+  if (command == "path") {
+    input = std::make_unique<std::ifstream>(value);
+    if (!*input) {
+      writeAll(connection_fd, "error cannot open " + value + "\n");
+      return;
+    }
+  } else {
+    string data;
+    size_t nr_bytes = std::stoul(value);
+    if (nr_bytes > MAX_DATA_SIZE) {
+      writeAll(connection_fd, "error data too large\n");
+      return;
+    }
+    if (!readBytes(connection_fd, nr_bytes, data)) {
+      writeAll(connection_fd, "error incomplete data\n");
+      return;
+    }
+    input = std::make_unique<std::istringstream>(std::move(data));
+  }
+  // The job runs in a child process, so that a crash on a malformed instance (such as a failed assertion in a
+  // parser) only ends this job and not the server.
+  pid_t pid = fork();
+  if (pid < 0) {
+    writeAll(connection_fd, string("error cannot start job (") + strerror(errno) + ")\n");
+    return;
+  }
+  if (pid == 0) {
+    std::ostringstream output;
+    string response;
+    try {
+      if (handler(options, *input, output)) {
+        auto result = output.str();
+        response = "ok " + std::to_string(result.size()) + "\n" + result;
+      } else {
+        response = "error invalid instance\n";
+      }
+    }
+    catch (std::exception& e) {
+      response = string("error ") + e.what() + "\n";
+    }
+    writeAll(connection_fd, response);
+    std::cerr.flush();
+    _exit(0);
+  }
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return;
+    }
+  }
+  // The child answers and exits with 0 unless it crashed.
+  if (WIFSIGNALED(status)) {
+    writeAll(connection_fd, "error job terminated by signal " + std::to_string(WTERMSIG(status)) + "\n");
+  } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    writeAll(connection_fd, "error job failed\n");
+  }
+}
+
+bool JobServer::waitReadable(int connection_fd) {
+  // Polls in intervals, so that a stop request is noticed while waiting for a client.
+  for (int waited = 0; waited < CONNECTION_TIMEOUT; waited += POLL_INTERVAL) {
+    if (stop && *stop) {
+      return false;
+    }
+    struct pollfd connection_poll = {connection_fd, POLLIN, 0};
+    int nr_ready = poll(&connection_poll, 1, POLL_INTERVAL);
+    if (nr_ready > 0) {
+      return true;
+    }
+    if (nr_ready < 0 && errno != EINTR) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool JobServer::readLine(int connection_fd, string& line) {
+  size_t newline_pos;
+  while ((newline_pos = read_buffer.find('\n')) == string::npos) {
+    if (read_buffer.size() > MAX_LINE_LENGTH) {
+      writeAll(connection_fd, "error line too long\n");
+      return false;
+    }
+    if (!waitReadable(connection_fd)) {
+      return false;
+    }
+    char chunk[4096];
+    auto nr_read = read(connection_fd, chunk, sizeof(chunk));
+    if (nr_read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (nr_read <= 0) {
+      return false;
+    }
+    read_buffer.append(chunk, nr_read);
+  }
+  line = read_buffer.substr(0, newline_pos);
+  read_buffer.erase(0, newline_pos + 1);
+  return true;
+}
+
+bool JobServer::readBytes(int connection_fd, size_t nr_bytes, string& data) {
+  data = read_buffer.substr(0, nr_bytes);
+  read_buffer.erase(0, data.size());
+  while (data.size() < nr_bytes) {
+    if (!waitReadable(connection_fd)) {
+      return false;
+    }
+    char chunk[65536];
+    auto nr_read = read(connection_fd, chunk, std::min(sizeof(chunk), nr_bytes - data.size()));
+    if (nr_read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (nr_read <= 0) {
+      return false;
+    }
+    data.append(chunk, nr_read);
+  }
+  return true;
+}
+
+bool JobServer::writeAll(int connection_fd, const string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    auto nr_written = write(connection_fd, data.data() + written, data.size() - written);
+    if (nr_written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (nr_written <= 0) {
+      return false;
+    }
+    written += nr_written;
+  }
+  return true;
+}
@@ -0,0 +1,60 @@
+#ifndef JobServer_h
+#define JobServer_h
+
+#include <functional>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <signal.h>
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+
+// Command line options (such as "--mode") and values sent along with a job.
+typedef vector<std::pair<string, string>> job_options;
+// Reads an instance from the input stream and writes the result to the output stream.
+typedef std::function<bool(const job_options&, std::istream&, std::ostream&)> job_handler;
+
+/*
+  Serves jobs on a Unix domain socket, one job per connection. A client sends a sequence of lines
+
+    option <name> <value>      (name is one of mode, conflict-limit, output-format, ordering, ordering-file)
+    path <filename>            (or)  data <number of bytes>, followed by the instance itself
+
+  and receives either "ok <number of bytes>" followed by the output, or "error <message>". Every job runs in a
+  forked child process, a job that crashes is answered with an error and the server keeps running. Connections are
+  served one at a time, clients that connect meanwhile wait in the listen queue. A connection is closed if the client
+  sends nothing for CONNECTION_TIMEOUT milliseconds or exceeds the limits on lines, options and data below.
+*/
+class JobServer {
+public:
+  JobServer(const string& socket_path);
+  ~JobServer();
+  int serve(const job_handler& handler, const volatile sig_atomic_t& stop);
+
+protected:
+  void handleConnection(int connection_fd, const job_handler& handler);
+  void runJob(int connection_fd, const string& command, std::istream& line_stream, const job_options& options, const job_handler& handler);
+  bool waitReadable(int connection_fd);
+  bool readLine(int connection_fd, string& line);
+  bool readBytes(int connection_fd, size_t nr_bytes, string& data);
+  bool writeAll(int connection_fd, const string& data);
+
+  string socket_path;
+  int server_fd;
+  string read_buffer;
+  const volatile sig_atomic_t* stop;
+
+  static const vector<string> JOB_OPTIONS;
+  static const int CONNECTION_TIMEOUT = 30000;
+  static const int POLL_INTERVAL = 1000;
+  static const size_t MAX_LINE_LENGTH = 65536;
+  static const unsigned int MAX_OPTIONS = 64;
+  static const size_t MAX_DATA_SIZE = size_t(1) << 30;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "MatrixPreprocessor.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+MatrixPreprocessor::MatrixPreprocessor(ClauseArena& formula, int max_variable_int): max_variable_int(max_variable_int), occurrences(2 * (max_variable_int + 1)), nr_occurrences(2 * (max_variable_int + 1), 0), frozen(max_variable_int + 1, false), eliminated(max_variable_int + 1, false), marks(max_variable_int + 1, 0), nr_eliminated(0) {
+  clauses.reserve(formula.size());
+  removed.reserve(formula.size());
+  vector<int> clause;
+  for (auto formula_clause: formula) {
+    clause.assign(formula_clause.begin(), formula_clause.end());
+    addClause(clause);
+  }
+}
+
+void MatrixPreprocessor::freeze(int variable) {
+  frozen[variable] = true;
+}
+
+unsigned int MatrixPreprocessor::numberEliminated() {
+  return nr_eliminated;
+}
+
+unsigned int MatrixPreprocessor::literalIndex(int literal) {
+  return 2 * abs(literal) + (literal < 0);
+}
+
+void MatrixPreprocessor::addClause(vector<int>& clause) {
+  // Sort by variable so that duplicate and complementary literals are adjacent.
+  std::sort(clause.begin(), clause.end(), [](int first, int second) {
+    return abs(first) < abs(second) || (abs(first) == abs(second) && first < second);
+  });
+  clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+  for (unsigned i = 1; i < clause.size(); i++) {
+    if (clause[i] == -clause[i - 1]) {
+      return;
+    }
+  }
+  unsigned int clause_index = clauses.size();
+  for (auto literal: clause) {
+    occurrences[literalIndex(literal)].push_back(clause_index);
+    nr_occurrences[literalIndex(literal)]++;
+  }
+  clauses.push_back(clause);
+  removed.push_back(false);
+}
+
+void MatrixPreprocessor::removeClause(unsigned int clause_index) {
+  removed[clause_index] = true;
+  for (auto literal: clauses[clause_index]) {
+    nr_occurrences[literalIndex(literal)]--;
+  }
+  vector<int>().swap(clauses[clause_index]);
+}
+
+vector<unsigned int> MatrixPreprocessor::liveOccurrences(int literal) {
+  auto& literal_occurrences = occurrences[literalIndex(literal)];
+  literal_occurrences.erase(std::remove_if(literal_occurrences.begin(), literal_occurrences.end(), [this](unsigned int clause_index) {
+    return removed[clause_index];
+  }), literal_occurrences.end());
+  return literal_occurrences;
+}
+
+bool MatrixPreprocessor::resolve(const vector<int>& positive, const vector<int>& negative, int variable, vector<int>& resolvent) {
+  // Returns false if the resolvent is a tautology.
+  resolvent.clear();
+  for (auto literal: positive) {
+    if (abs(literal) != variable) {
+      marks[abs(literal)] = literal;
+      resolvent.push_back(literal);
+    }
+  }
+  bool tautology = false;
+  for (auto literal: negative) {
+    if (abs(literal) == variable) {
+      continue;
+    }
+    if (marks[abs(literal)] == -literal) {
+      tautology = true;
+      break;
+    } else if (marks[abs(literal)] != literal) {
+      resolvent.push_back(literal);
+    }
+  }
+  for (auto literal: positive) {
+    marks[abs(literal)] = 0;
+  }
+  return !tautology;
+}
+
+bool MatrixPreprocessor::eliminate(int variable, vector<int>& touched) {
+  auto positive = liveOccurrences(variable);
+  auto negative = liveOccurrences(-variable);
+  if (positive.empty() && negative.empty()) {
+    return false;
+  }
+  // Pure literals are always eliminated, otherwise the number of resolvents is bounded.
+  if (!positive.empty() && !negative.empty() && (positive.size() > OCCURRENCE_LIMIT || negative.size() > OCCURRENCE_LIMIT)) {
+    return false;
+  }
+  vector<vector<int>> resolvents;
+  vector<int> resolvent;
+  for (auto positive_index: positive) {
+    for (auto negative_index: negative) {
+      if (resolve(clauses[positive_index], clauses[negative_index], variable, resolvent)) {
+        if (resolvent.size() > RESOLVENT_LENGTH_LIMIT || resolvents.size() == positive.size() + negative.size()) {
+          return false;
+        }
+        resolvents.push_back(resolvent);
+      }
+    }
+  }
+  for (auto occurrence_list: { &positive, &negative }) {
+    for (auto clause_index: *occurrence_list) {
+      for (auto literal: clauses[clause_index]) {
+        touched.push_back(abs(literal));
+      }
+      removeClause(clause_index);
+    }
+  }
+  for (auto& new_clause: resolvents) {
+    addClause(new_clause);
+  }
+  eliminated[variable] = true;
+  nr_eliminated++;
+  return true;
+}
+
+void MatrixPreprocessor::eliminateVariables() {
+  vector<int> candidates;
+  for (int variable = 1; variable <= max_variable_int; variable++) {
+    if (!frozen[variable] && nr_occurrences[literalIndex(variable)] + nr_occurrences[literalIndex(-variable)] > 0) {
+      candidates.push_back(variable);
+    }
+  }
+  vector<bool> queued(max_variable_int + 1, false);
+  for (unsigned int pass = 0; pass < MAX_PASSES && !candidates.empty(); pass++) {
+    // Cheap eliminations first.
+    std::stable_sort(candidates.begin(), candidates.end(), [this](int first, int second) {
+      return long(nr_occurrences[literalIndex(first)]) * nr_occurrences[literalIndex(-first)] < long(nr_occurrences[literalIndex(second)]) * nr_occurrences[literalIndex(-second)];
+    });
+    vector<int> touched;
+    for (auto variable: candidates) {
+      if (!eliminated[variable]) {
+        eliminate(variable, touched);
+      }
+    }
+    // Variables that shared a clause with an eliminated variable are tried again.
+    candidates.clear();
+    for (auto variable: touched) {
+      if (!frozen[variable] && !eliminated[variable] && !queued[variable]) {
+        queued[variable] = true;
+        candidates.push_back(variable);
+      }
+    }
+    for (auto variable: candidates) {
+      queued[variable] = false;
+    }
+  }
+}
+
+void MatrixPreprocessor::subsume() {
+  vector<unsigned int> order;
+  for (unsigned int clause_index = 0; clause_index < clauses.size(); clause_index++) {
+    if (!removed[clause_index]) {
+      order.push_back(clause_index);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [this](unsigned int first, unsigned int second) {
+    return clauses[first].size() < clauses[second].size();
+  });
+  for (auto clause_index: order) {
+    if (removed[clause_index] || clauses[clause_index].empty()) {
+      continue;
+    }
+    auto& clause = clauses[clause_index];
+    // Clauses subsumed by this one contain its least frequent literal.
+    int rarest = clause[0];
+    for (auto literal: clause) {
+      if (nr_occurrences[literalIndex(literal)] < nr_occurrences[literalIndex(rarest)]) {
+        rarest = literal;
+      }
+    }
+    if (nr_occurrences[literalIndex(rarest)] > SUBSUMPTION_OCCURRENCE_LIMIT) {
+      continue;
+    }
+    for (auto literal: clause) {
+      marks[abs(literal)] = literal;
+    }
+    for (auto other_index: liveOccurrences(rarest)) {
+      if (other_index == clause_index || clauses[other_index].size() < clause.size()) {
+        continue;
+      }
+      unsigned int nr_common = 0;
+      for (auto literal: clauses[other_index]) {
+        nr_common += (marks[abs(literal)] == literal);
+      }
+      if (nr_common == clause.size()) {
+        removeClause(other_index);
+      }
+    }
+    for (auto literal: clause) {
+      marks[abs(literal)] = 0;
+    }
+  }
+}
+
+ClauseArena MatrixPreprocessor::preprocess() {
+  subsume();
+  eliminateVariables();
+  subsume();
+  ClauseArena result;
+  unsigned long nr_clauses = 0, nr_literals = 0;
+  for (unsigned int clause_index = 0; clause_index < clauses.size(); clause_index++) {
+    if (!removed[clause_index]) {
+      nr_clauses++;
+      nr_literals += clauses[clause_index].size();
+    }
+  }
+  result.reserve(nr_clauses, nr_literals);
+  for (unsigned int clause_index = 0; clause_index < clauses.size(); clause_index++) {
+    if (!removed[clause_index]) {
+      result.addClause(clauses[clause_index]);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,51 @@
+#ifndef MatrixPreprocessor_h
+#define MatrixPreprocessor_h
+
+#include <vector>
+
+#include "ClauseArena.h"
+
+using std::vector;
+
+/*
+  Shrinks the propositional matrix before it is loaded into the solver, by subsumption and bounded
+  variable elimination (a variable is eliminated if the non-tautological resolvents of its clauses
+  are no more than the clauses themselves). Frozen variables are never eliminated, so the result is
+  equivalent to the matrix with the remaining variables existentially quantified, which preserves
+  definability in terms of frozen variables.
+*/
+class MatrixPreprocessor {
+public:
+  MatrixPreprocessor(ClauseArena& formula, int max_variable_int);
+  void freeze(int variable);
+  ClauseArena preprocess();
+  unsigned int numberEliminated();
+
+protected:
+  static unsigned int literalIndex(int literal);
+  void addClause(vector<int>& clause);
+  void removeClause(unsigned int clause_index);
+  vector<unsigned int> liveOccurrences(int literal);
+  bool resolve(const vector<int>& positive, const vector<int>& negative, int variable, vector<int>& resolvent);
+  bool eliminate(int variable, vector<int>& touched);
+  void eliminateVariables();
+  void subsume();
+
+  int max_variable_int;
+  vector<vector<int>> clauses;
+  vector<bool> removed;
+  // Clause indices per literal, may contain removed clauses.
+  vector<vector<unsigned int>> occurrences;
+  vector<unsigned int> nr_occurrences;
+  vector<bool> frozen;
+  vector<bool> eliminated;
+  vector<int> marks;
+  unsigned int nr_eliminated;
+
+  static const unsigned int OCCURRENCE_LIMIT = 16;
+  static const unsigned int RESOLVENT_LENGTH_LIMIT = 20;
+  static const unsigned int SUBSUMPTION_OCCURRENCE_LIMIT = 1000;
+  static const unsigned int MAX_PASSES = 4;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "MiniSatBackend.h"
+
+#include <new>
+#include <stdlib.h>
+
+MiniSatBackend::MiniSatBackend(int nr_variables, bool decide_failed_queries): solver(nr_variables), interrupted(false) {
+  if (decide_failed_queries) {
+    checker = std::make_unique<Minisat::Solver>();
+    // Variable 0 is unused, so that variables need not be shifted.
+    for (int variable = 0; variable <= nr_variables; variable++) {
+      checker->newVar();
+    }
+  }
+}
+
+int MiniSatBackend::miniSatLiteral(int literal) {
+  return 2 * abs(literal) + (literal < 0);
+}
+
+vector<int>& MiniSatBackend::makeMiniSatClause(const vector<int>& clause) {
+  literal_buffer.clear();
+  for (auto literal: clause) {
+    literal_buffer.push_back(miniSatLiteral(literal));
+  }
+  return literal_buffer;
+}
+
+Minisat::vec<Minisat::Lit>& MiniSatBackend::makeCheckerClause(const vector<int>& clause) {
+  checker_buffer.clear();
+  for (auto literal: clause) {
+    checker_buffer.push(Minisat::mkLit(abs(literal), literal < 0));
+  }
+  return checker_buffer;
+}
+
+bool MiniSatBackend::addClause(const vector<int>& clause, int partition) {
+  try {
+    if (checker) {
+      // The partitions are over disjoint variables (apart from shared ones), their union is the formula.
+      checker->addClause(makeCheckerClause(clause));
+    }
+    return solver.addClause(makeMiniSatClause(clause), partition);
+  }
+  catch (Minisat::OutOfMemoryException&) {
+    throw std::bad_alloc();
+  }
+}
+
+bool MiniSatBackend::solve() {
+  try {
+    return solver.solve();
+  }
+  catch (Minisat::OutOfMemoryException&) {
+    throw std::bad_alloc();
+  }
+}
+
+QueryResult MiniSatBackend::getInterpolant(int variable, const vector<int>& assumptions, vector<int>& shared_variables, int conflict_limit) {
+  try {
+    if (!solver.getInterpolant(variable, makeMiniSatClause(assumptions), shared_variables, conflict_limit)) {
+      return QueryResult::Defined;
+    }
+    if (interrupted) {
+      return QueryResult::Unknown;
+    }
+    if (conflict_limit == 0) {
+      return QueryResult::NotDefined;
+    }
+    if (checker) {
+      // A query the checker refutes is defined, but without an interpolant it stays Unknown.
+      checker->setConfBudget(conflict_limit);
+      if (checker->solveLimited(makeCheckerClause(assumptions)) == l_True) {
+        return QueryResult::NotDefined;
+      }
+    }
+    return QueryResult::Unknown;
+  }
+  catch (Minisat::OutOfMemoryException&) {
+    throw std::bad_alloc();
+  }
+}
+
+Aig_Man_t* MiniSatBackend::getCircuit(vector<int>& shared_variables, bool compute_interpolants) {
+  try {
+    return solver.getCircuit(shared_variables, compute_interpolants);
+  }
+  catch (Minisat::OutOfMemoryException&) {
+    throw std::bad_alloc();
+  }
+}
+
+void MiniSatBackend::interrupt() {
+  interrupted = true;
+  solver.interrupt();
+  if (checker) {
+    checker->interrupt();
+  }
+}
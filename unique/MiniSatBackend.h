@@ -0,0 +1,41 @@
+#ifndef MiniSatBackend_h
+#define MiniSatBackend_h
+
+#include <atomic>
+
+#include "InterpolationBackend.h"
+#include "minisat/core/Solver.h"
+
+/*
+  Interpolating MiniSat (from the interpolatingsolver submodule), definitions are interpolants
+  computed from resolution proofs. The solver only reports whether a query succeeded, so a failed
+  query under a conflict limit cannot be told apart from a counterexample. With decide_failed_queries,
+  a plain MiniSat instance on the same clauses (from both partitions) runs failed queries again under
+  the same limit: the query is NotDefined if it finds a counterexample, and Unknown otherwise. This
+  costs a second copy of the clauses. Without it, failed queries under a conflict limit are Unknown.
+*/
+class MiniSatBackend: public InterpolationBackend {
+public:
+  MiniSatBackend(int nr_variables, bool decide_failed_queries = false);
+  bool addClause(const vector<int>& clause, int partition = 0) override;
+  bool solve() override;
+  QueryResult getInterpolant(int variable, const vector<int>& assumptions, vector<int>& shared_variables, int conflict_limit) override;
+  Aig_Man_t* getCircuit(vector<int>& shared_variables, bool compute_interpolants) override;
+  void interrupt() override;
+
+protected:
+  static int miniSatLiteral(int literal);
+  vector<int>& makeMiniSatClause(const vector<int>& clause);
+  Minisat::vec<Minisat::Lit>& makeCheckerClause(const vector<int>& clause);
+
+  InterpolatingSolver solver;
+  // Decides failed queries (see above), nullptr unless created with decide_failed_queries.
+  unique_ptr<Minisat::Solver> checker;
+  Minisat::vec<Minisat::Lit> checker_buffer;
+  // Set before the solver is interrupted, so that an interrupted query is not taken for a counterexample.
+  std::atomic<bool> interrupted;
+  // Reused for converting clauses and assumptions to MiniSat literals.
+  vector<int> literal_buffer;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "OutputBuffer.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+OutputBuffer::OutputBuffer(std::ostream& out, size_t capacity): stream(&out), fd(-1), memory_mapped(false), failed(!out), storage(capacity), buffer_start(storage.data()), position(buffer_start), buffer_end(buffer_start + capacity), mapping_offset(0) {}
+
+OutputBuffer::OutputBuffer(const string& filename, bool memory_mapped, size_t capacity): stream(nullptr), fd(-1), memory_mapped(memory_mapped), failed(false), buffer_start(nullptr), position(nullptr), buffer_end(nullptr), mapping_offset(0) {
+  fd = open(filename.c_str(), (memory_mapped ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC, 0644);
+  failed = (fd < 0);
+  if (memory_mapped && !failed) {
+    mapNextWindow();
+  } else {
+    // Without a file there is nothing to map, output is discarded through the buffer.
+    this->memory_mapped = false;
+    storage.resize(capacity);
+    buffer_start = position = storage.data();
+    buffer_end = buffer_start + capacity;
+  }
+}
+
+OutputBuffer::~OutputBuffer() {
+  close();
+}
+
+void OutputBuffer::close() {
+  if (memory_mapped) {
+    closeMapping();
+    memory_mapped = false;
+  } else {
+    flush();
+  }
+  if (fd >= 0) {
+    if (::close(fd) != 0) {
+      failed = true;
+    }
+    fd = -1;
+  }
+}
+
+void OutputBuffer::writeThrough(const char* data, size_t size) {
+  if (failed) {
+    return;
+  }
+  if (stream) {
+    stream->write(data, size);
+    failed = !(*stream);
+    return;
+  }
+  while (size > 0) {
+    auto nr_written = ::write(fd, data, size);
+    if (nr_written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (nr_written <= 0) {
+      failed = true;
+      return;
+    }
+    data += nr_written;
+    size -= nr_written;
+  }
+}
+
+void OutputBuffer::flush() {
+  if (memory_mapped) {
+    return;
+  }
+  writeThrough(buffer_start, position - buffer_start);
+  position = buffer_start;
+  if (stream && !failed) {
+    stream->flush();
+  }
+}
+
+void OutputBuffer::makeRoom(size_t size) {
+  if (memory_mapped) {
+    mapNextWindow();
+  } else {
+    writeThrough(buffer_start, position - buffer_start);
+    position = buffer_start;
+  }
+  if (failed) {
+    // Keep accepting (and discarding) output after an error.
+    position = buffer_start;
+  }
+}
+
+void OutputBuffer::writeLarge(const char* data, size_t size) {
+  if (!memory_mapped) {
+    makeRoom(size);
+    if (size >= storage.size()) {
+      writeThrough(data, size);
+      return;
+    }
+  }
+  while (size > 0) {
+    if (position == buffer_end) {
+      makeRoom(size);
+    }
+    size_t chunk_size = std::min(size, size_t(buffer_end - position));
+    std::memcpy(position, data, chunk_size);
+    position += chunk_size;
+    data += chunk_size;
+    size -= chunk_size;
+  }
+}
+
+void OutputBuffer::mapNextWindow() {
+  // Unmap the filled part of the current window and map a fresh window directly behind it.
+  if (buffer_start != nullptr) {
+    size_t used = position - buffer_start;
+    munmap(buffer_start, MAPPING_SIZE);
+    mapping_offset += used;
+  }
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t window_offset = mapping_offset - mapping_offset % page_size;
+  size_t window_skip = mapping_offset - window_offset;
+  void* window = MAP_FAILED;
+  // Blocks are allocated before the window is mapped (which also extends the file): a store to a mapped page that the
+  // file system cannot back raises SIGBUS, whereas a failed allocation falls back to write(), which reports errors.
+  if (!failed && posix_fallocate(fd, window_offset, MAPPING_SIZE) == 0) {
+    window = mmap(nullptr, MAPPING_SIZE, PROT_WRITE, MAP_SHARED, fd, window_offset);
+  }
+  if (window == MAP_FAILED) {
+    // Fall back to ordinary writes behind the data that was mapped so far.
+    failed = failed || ftruncate(fd, mapping_offset) != 0 || lseek(fd, mapping_offset, SEEK_SET) < 0;
+    memory_mapped = false;
+    storage.resize(DEFAULT_CAPACITY);
+    buffer_start = position = storage.data();
+    buffer_end = buffer_start + storage.size();
+    return;
+  }
+  // buffer_start points to the mapping itself, position to where output continues.
+  buffer_start = static_cast<char*>(window);
+  position = buffer_start + window_skip;
+  buffer_end = buffer_start + MAPPING_SIZE;
+  mapping_offset = window_offset;
+}
+
+void OutputBuffer::closeMapping() {
+  if (buffer_start != nullptr) {
+    size_t used = position - buffer_start;
+    munmap(buffer_start, MAPPING_SIZE);
+    mapping_offset += used;
+    buffer_start = position = buffer_end = nullptr;
+  }
+  if (ftruncate(fd, mapping_offset) != 0) {
+    failed = true;
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef OutputBuffer_h
+#define OutputBuffer_h
+
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using std::string;
+
+/*
+  Buffered output for the writers: data is collected in a large user-space buffer and handed
+  to a stream or file descriptor in big chunks (or written directly into a memory-mapped file),
+  integers are formatted with std::to_chars.
+*/
+class OutputBuffer {
+public:
+  OutputBuffer(std::ostream& out, size_t capacity = DEFAULT_CAPACITY);
+  OutputBuffer(const string& filename, bool memory_mapped = false, size_t capacity = DEFAULT_CAPACITY);
+  ~OutputBuffer();
+  OutputBuffer(const OutputBuffer&) = delete;
+  OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+  bool good() const {
+    return !failed;
+  }
+
+  void write(const char* data, size_t size) {
+    if (size > size_t(buffer_end - position)) {
+      writeLarge(data, size);
+      return;
+    }
+    std::memcpy(position, data, size);
+    position += size;
+  }
+
+  OutputBuffer& operator<<(char c) {
+    if (position == buffer_end) {
+      makeRoom(1);
+    }
+    *position++ = c;
+    return *this;
+  }
+
+  OutputBuffer& operator<<(const string& s) {
+    write(s.data(), s.size());
+    return *this;
+  }
+
+  OutputBuffer& operator<<(const char* s) {
+    write(s, std::strlen(s));
+    return *this;
+  }
+
+  template<typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>>>
+  OutputBuffer& operator<<(T value) {
+    if (buffer_end - position < MAX_INTEGER_LENGTH) {
+      makeRoom(MAX_INTEGER_LENGTH);
+    }
+    position = std::to_chars(position, buffer_end, value).ptr;
+    return *this;
+  }
+
+  void flush();
+  // Writes all remaining output and closes the file, good() then tells whether all output was written.
+  void close();
+
+  static const size_t DEFAULT_CAPACITY = 1 << 20;
+  static const size_t MAPPING_SIZE = 64 << 20;
+
+protected:
+  void makeRoom(size_t size);
+  void writeLarge(const char* data, size_t size);
+  void writeThrough(const char* data, size_t size);
+  void mapNextWindow();
+  void closeMapping();
+
+  static const int MAX_INTEGER_LENGTH = 24;
+
+  std::ostream* stream;
+  int fd;
+  bool memory_mapped;
+  bool failed;
+  std::vector<char> storage;
+  char* buffer_start;
+  char* position;
+  char* buffer_end;
+  size_t mapping_offset;
+};
+
+#endif
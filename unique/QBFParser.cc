@@ -5,13 +5,20 @@
 #include <iostream>
 #include <assert.h>
 #include <algorithm>
-#include <iterator>
+#include <unordered_set>
+#include <exception>
+#include <thread>
+#include <cstdint>
+#include <pthread.h>
+#include <signal.h>
 
 const string QBFParser::FORALL_STRING = "forall";
 const string QBFParser::EXISTS_STRING = "exists";
 const string QBFParser::OUTPUT_STRING = "output";
 const string QBFParser::AND_STRING = "and";
 const string QBFParser::OR_STRING = "or";
+const string QBFParser::XOR_STRING = "xor";
+const string QBFParser::ITE_STRING = "ite";
 
 using std::make_tuple;
 
@@ -34,7 +41,7 @@ GatePolarity operator+(const GatePolarity& first, const GatePolarity& second) {
   }
 }
 
-QBFParser::QBFParser(): max_quantifier_depth(0), max_alias(0), output_id(""), variable_gate_boundary(1), number_variables{0, 0}, max_id_number(0), comparator(nullptr) {
+QBFParser::QBFParser(): max_quantifier_depth(0), max_alias(0), output_id(""), variable_gate_boundary(1), number_variables{0, 0}, max_id_number(0), comparator(nullptr), ordering_strategy(OrderingStrategy::Input), statistics(nullptr), universal_extractor(nullptr), verbose(true), nr_redundant_gates(0), fanout_counts_valid(false), topological_order_valid(false), structural_hashing(false), true_alias(0) {
   gates.push_back(Gate("")); // Add dummy gate for 1-based indexing.
 }
 
@@ -42,6 +49,32 @@ void QBFParser::setComparator(const string& comparator_filename) {
   comparator = new VariableComparator(comparator_filename);
 }
 
+void QBFParser::setOrdering(OrderingStrategy strategy) {
+  ordering_strategy = strategy;
+}
+
+void QBFParser::setStatistics(Statistics* statistics) {
+  this->statistics = statistics;
+}
+
+void QBFParser::setUniversalExtractor(Extractor* universal_extractor) {
+  this->universal_extractor = universal_extractor;
+}
+
+void QBFParser::setVerbose(bool verbose) {
+  this->verbose = verbose;
+}
+
+void QBFParser::printParseStatistics() {
+  std::cerr << "Done parsing " << gates.size() << " gates." << std::endl;
+  std::cerr << "Removed " << nr_redundant_gates << " redundant gates." << std::endl;
+}
+
+void QBFParser::keepDefinitionCircuit() {
+  // Needed for AIGER output, which is written from the circuits rather than the definition gates.
+  definition_circuit = std::make_unique<DefinitionCircuit>();
+}
+
 QBFParser::~QBFParser() {
   for (auto& gate: gates) {
     delete[] gate.gate_inputs;
@@ -79,43 +112,205 @@ void QBFParser::addVariable(const string& id, const VariableType type) {
     number_variables[1]++;
   }
   variable_gate_boundary++;
+  invalidateGraphCache();
 }
 
 void QBFParser::addGate(const string& id, const GateType& gate_type, const vector<string>& input_literals) {
-  assert(gate_type == GateType::And || gate_type == GateType::Or);
+  assert(isGateType(gate_type));
   if (isNumber(id)) {
     max_id_number = std::max(max_id_number, std::stoi(id));
   }
-  int alias = getAlias(id);
+  vector<int> inputs;
+  inputs.reserve(input_literals.size());
+  for (auto& literal_string: input_literals) {
+    string input_id = literal_string.front() == '-' ? literal_string.substr(1): literal_string;
+    inputs.push_back(sign(literal_string) * getAlias(input_id));
+  }
+  if (structural_hashing && gate_type == GateType::Xor) {
+    addHashedXorGate(id, inputs);
+  } else if (structural_hashing && gate_type == GateType::Ite) {
+    addHashedIteGate(id, inputs);
+  } else if (structural_hashing) {
+    addHashedGate(id, gate_type, inputs);
+  } else {
+    createGate(getAlias(id), gate_type, inputs);
+  }
+}
+
+void QBFParser::createGate(int alias, const GateType& gate_type, const vector<int>& inputs) {
   assert(alias < gates.size());
   assert(gates[alias].gate_inputs == nullptr);
   assert(gates[alias].gate_type == GateType::None);
   gates[alias].gate_type = gate_type;
-  gates[alias].gate_inputs = new int[input_literals.size()];
-  for (unsigned i = 0; i < input_literals.size(); i++) {
-    auto& literal_string = input_literals[i];
-    string input_id = literal_string.front() == '-' ? literal_string.substr(1): literal_string;
-    int input_alias = getAlias(input_id);
-    gates[alias].gate_inputs[i] = sign(literal_string) * input_alias;
+  gates[alias].gate_inputs = new int[inputs.size()];
+  std::copy(inputs.begin(), inputs.end(), gates[alias].gate_inputs);
+  gates[alias].nr_inputs = inputs.size();
+  invalidateGraphCache();
+}
+
+void QBFParser::addHashedGate(const string& id, const GateType& gate_type, vector<int>& inputs) {
+  // OR gates are hashed as negated AND gates: or(l1, ..., ln) = -and(-l1, ..., -ln).
+  int polarity = (gate_type == GateType::And) ? 1 : -1;
+  bool is_false = false;
+  vector<int> and_inputs;
+  for (auto literal: inputs) {
+    literal *= polarity;
+    int value = constantValue(literal);
+    if (value == -1) {
+      is_false = true;
+      break;
+    } else if (value == 0) {
+      and_inputs.push_back(literal);
+    }
+  }
+  std::sort(and_inputs.begin(), and_inputs.end(), [](int first, int second) {
+    return abs(first) < abs(second) || (abs(first) == abs(second) && first < second);
+  });
+  and_inputs.erase(std::unique(and_inputs.begin(), and_inputs.end()), and_inputs.end());
+  for (unsigned i = 1; i < and_inputs.size() && !is_false; i++) {
+    is_false = (and_inputs[i] == -and_inputs[i - 1]);
+  }
+  if (is_false) {
+    and_inputs.clear();
   }
-  gates[alias].nr_inputs = input_literals.size();
+  bool is_constant = is_false || and_inputs.empty();
+  // The value of the gate, if it is a constant.
+  bool constant_value = (polarity == 1) != is_false;
+  vector<int> gate_inputs;
+  for (auto literal: and_inputs) {
+    gate_inputs.push_back(polarity * literal);
+  }
+  if (and_inputs.size() < 2) {
+    and_inputs.clear();
+  }
+  addNormalizedGate(id, gate_type, gate_inputs, and_inputs, polarity, is_constant ? (constant_value ? 1 : -1) : 0);
 }
 
-unsigned int QBFParser::removeRedundant() {
-  vector<int> nr_outputs(gates.size(), 0);
-  for (unsigned i = variable_gate_boundary; i < gates.size(); i++) {
-    auto& gate = gates[i];
-    if (gate.gate_type == GateType::And || gate.gate_type == GateType::Or) {
-      for (unsigned i = 0; i < gate.nr_inputs; i++) {
-        auto variable_alias = abs(gate.gate_inputs[i]);
-        nr_outputs[variable_alias]++;
+void QBFParser::addHashedXorGate(const string& id, const vector<int>& inputs) {
+  // Signs and constant inputs are moved to the output: xor(-a, b) = -xor(a, b), xor(true, b) = -b.
+  int polarity = 1;
+  vector<int> variables;
+  for (auto literal: inputs) {
+    if (literal < 0) {
+      polarity = -polarity;
+    }
+    int value = constantValue(abs(literal));
+    if (value > 0) {
+      polarity = -polarity;
+    } else if (value == 0) {
+      variables.push_back(abs(literal));
+    }
+  }
+  std::sort(variables.begin(), variables.end());
+  if (variables.size() == 2 && variables[0] == variables[1]) {
+    variables.clear();
+  }
+  if (variables.empty()) {
+    addNormalizedGate(id, GateType::And, {}, {}, 1, -polarity);
+  } else if (variables.size() == 1) {
+    addNormalizedGate(id, GateType::And, {polarity * variables[0]}, {}, 1, 0);
+  } else {
+    // Keys of XOR gates start with 0, which distinguishes them from keys of AND gates.
+    addNormalizedGate(id, GateType::Xor, {polarity * variables[0], variables[1]}, {0, variables[0], variables[1]}, polarity, 0);
+  }
+}
+
+void QBFParser::addHashedIteGate(const string& id, const vector<int>& inputs) {
+  // The condition is made positive (by swapping branches), and so is the first branch: ite(c, -t, -e) = -ite(c, t, e).
+  int condition = inputs[0];
+  int then_literal = inputs[1];
+  int else_literal = inputs[2];
+  if (condition < 0) {
+    condition = -condition;
+    std::swap(then_literal, else_literal);
+  }
+  int value = constantValue(condition);
+  if (value != 0 || then_literal == else_literal) {
+    addNormalizedGate(id, GateType::And, {value < 0 ? else_literal : then_literal}, {}, 1, 0);
+    return;
+  }
+  int polarity = (then_literal > 0) ? 1 : -1;
+  then_literal *= polarity;
+  else_literal *= polarity;
+  // Keys of ITE gates start with two 0s.
+  addNormalizedGate(id, GateType::Ite, {condition, polarity * then_literal, polarity * else_literal}, {0, 0, condition, then_literal, else_literal}, polarity, 0);
+}
+
+void QBFParser::addNormalizedGate(const string& id, const GateType& gate_type, const vector<int>& inputs, const vector<int>& key, int key_polarity, int value) {
+  // The gate is the constant value if value != 0, otherwise it is gate_type(inputs), which is equal to key_polarity
+  // times the gate stored under key (unless key is empty). Single-input AND/OR gates are equal to their input.
+  // Gates that were referenced before (or the output) need a gate of their own.
+  bool needs_gate = id == output_id || output_id.empty() || id_to_alias.find(id) != id_to_alias.end();
+  if (!needs_gate) {
+    if (value != 0 && true_alias != 0) {
+      id_to_alias[id] = value * true_alias;
+      return;
+    } else if (value == 0 && inputs.size() == 1 && (gate_type == GateType::And || gate_type == GateType::Or)) {
+      id_to_alias[id] = inputs.front();
+      return;
+    } else if (value == 0 && !key.empty()) {
+      auto it = gate_hash.find(key);
+      if (it != gate_hash.end()) {
+        id_to_alias[id] = key_polarity * it->second;
+        return;
+      }
+    }
+  }
+
+  int alias = getAlias(id);
+  if (value != 0) {
+    createGate(alias, value > 0 ? GateType::And : GateType::Or, {});
+    if (true_alias == 0) {
+      true_alias = value * alias;
+    }
+  } else {
+    createGate(alias, gate_type, inputs);
+    if (!key.empty()) {
+      gate_hash.emplace(key, key_polarity * alias);
+    }
+  }
+}
+
+void QBFParser::endStructuralHashing() {
+  // Gates may change after parsing (definitions, simplification), so the table is not kept.
+  structural_hashing = false;
+  true_alias = 0;
+  unordered_map<vector<int>, int, GateInputsHash>().swap(gate_hash);
+}
+
+void QBFParser::invalidateGraphCache() {
+  fanout_counts_valid = false;
+  topological_order_valid = false;
+  for (auto& polarity: polarity_cache) {
+    polarity.clear();
+  }
+}
+
+const vector<int>& QBFParser::getFanoutCounts() {
+  if (!fanout_counts_valid) {
+    fanout_counts.assign(gates.size(), 0);
+    for (unsigned alias = 1; alias < gates.size(); alias++) {
+      auto& gate = gates[alias];
+      if (isGateType(gate.gate_type)) {
+        for (unsigned i = 0; i < gate.nr_inputs; i++) {
+          fanout_counts[abs(gate.gate_inputs[i])]++;
+        }
       }
     }
+    fanout_counts_valid = true;
   }
+  return fanout_counts;
+}
+
+unsigned int QBFParser::removeRedundant() {
+  // Fan-out counts are updated as gates are deleted, so the cache stays valid.
+  getFanoutCounts();
+  auto& nr_outputs = fanout_counts;
   vector<int> queue;
-  for (unsigned alias = variable_gate_boundary; alias < gates.size(); alias++) {
+  // Start at 1, defined variables are AND gates below the variable boundary.
+  for (unsigned alias = 1; alias < gates.size(); alias++) {
     auto& gate = gates[alias];
-    if (gate.gate_id != output_id && nr_outputs[alias] == 0 && (gate.gate_type == GateType::And || gate.gate_type == GateType::Or)) {
+    if (gate.gate_id != output_id && nr_outputs[alias] == 0 && isGateType(gate.gate_type)) {
       queue.push_back(alias);
     }
   }
@@ -129,116 +324,251 @@ unsigned int QBFParser::removeRedundant() {
       for (unsigned i = 0; i < gate.nr_inputs; i++ ) {
         auto variable_alias = abs(gate.gate_inputs[i]);
         nr_outputs[variable_alias]--;
-        if (nr_outputs[variable_alias] == 0 && (gates[variable_alias].gate_type == GateType::And || gates[variable_alias].gate_type == GateType::Or)) {
+        if (nr_outputs[variable_alias] == 0 && isGateType(gates[variable_alias].gate_type)) {
           // Don't put input gates on the queue (i.e. don't delete input variables).
           queue.push_back(variable_alias);
         }
       }
     }
   }
+  if (nr_deleted > 0) {
+    topological_order_valid = false;
+    for (auto& polarity: polarity_cache) {
+      polarity.clear();
+    }
+  }
   return nr_deleted;
 }
 
-void QBFParser::getGatePolarities(vector<GatePolarity>& polarity, GatePolarity output_polarity) {
-  vector<int> nr_output_gates(gates.size(), 0);
-  for (unsigned i = 1; i < gates.size(); i++) {
-    auto& gate = gates[i];
-    if (gate.gate_type == GateType::And || gate.gate_type == GateType::Or) {
+int QBFParser::constantValue(int literal) {
+  // Empty AND gates are true, empty OR gates are false.
+  auto& gate = gates[abs(literal)];
+  if (gate.nr_inputs != 0 || (gate.gate_type != GateType::And && gate.gate_type != GateType::Or)) {
+    return 0;
+  }
+  int value = (gate.gate_type == GateType::And) ? 1 : -1;
+  return literal > 0 ? value : -value;
+}
+
+unsigned int QBFParser::simplify() {
+  PhaseTimer simplify_timer(statistics, "simplify");
+  auto output_alias = id_to_alias[output_id];
+  auto& output_gate = gates[output_alias];
+  // Direct inputs of the output are kept as gates (QDIMACS prints them as clauses).
+  vector<bool> output_input(gates.size(), false);
+  for (unsigned i = 0; i < output_gate.nr_inputs; i++) {
+    output_input[abs(output_gate.gate_inputs[i])] = true;
+  }
+  vector<int> gates_ordered = gateTopologicalOrdering();
+  vector<int> replacement(gates.size(), 0);
+  vector<int> seen(gates.size(), 0);
+  // Inputs are simplified before the gates that use them.
+  for (auto alias: gates_ordered) {
+    auto& gate = gates[alias];
+    if (gate.gate_type == GateType::Xor || gate.gate_type == GateType::Ite) {
+      // The number of inputs is fixed, so only single-input gates are substituted.
       for (unsigned i = 0; i < gate.nr_inputs; i++) {
-        auto variable_alias = abs(gate.gate_inputs[i]);
-        nr_output_gates[variable_alias]++;
+        int literal = gate.gate_inputs[i];
+        if (replacement[abs(literal)] != 0) {
+          gate.gate_inputs[i] = (literal > 0) ? replacement[abs(literal)] : -replacement[abs(literal)];
+        }
+      }
+      continue;
+    } else if (gate.gate_type != GateType::And && gate.gate_type != GateType::Or) {
+      continue;
+    }
+    bool is_and = (gate.gate_type == GateType::And);
+    bool is_constant = false;
+    unsigned int nr_inputs = 0;
+    for (unsigned i = 0; i < gate.nr_inputs && !is_constant; i++) {
+      int literal = gate.gate_inputs[i];
+      int input_alias = abs(literal);
+      if (replacement[input_alias] != 0) {
+        // Substitute the input of a single-input gate, such as a definition y = g.
+        literal = (literal > 0) ? replacement[input_alias] : -replacement[input_alias];
+        input_alias = abs(literal);
+      }
+      int value = constantValue(literal);
+      int signed_alias = (literal > 0) ? int(alias) : -int(alias);
+      if (value != 0) {
+        // Drop neutral constants, absorbing constants make the gate constant.
+        is_constant = ((value > 0) != is_and);
+      } else if (seen[input_alias] == -signed_alias) {
+        is_constant = true;
+      } else if (seen[input_alias] != signed_alias) {
+        seen[input_alias] = signed_alias;
+        gate.gate_inputs[nr_inputs++] = literal;
       }
     }
+    if (is_constant) {
+      // AND becomes false (empty OR), OR becomes true (empty AND).
+      gate.gate_type = is_and ? GateType::Or : GateType::And;
+      nr_inputs = 0;
+    }
+    gate.nr_inputs = nr_inputs;
+    if (nr_inputs == 1 && alias != output_alias && !output_input[alias]) {
+      replacement[alias] = gate.gate_inputs[0];
+    }
+  }
+  invalidateGraphCache();
+  unsigned int nr_removed_gates = removeRedundant();
+  // Variables that no longer occur are removed from the prefix.
+  auto& nr_output_gates = getFanoutCounts();
+  unsigned int nr_removed_variables = 0;
+  for (int alias = 1; alias < variable_gate_boundary; alias++) {
+    auto& gate = gates[alias];
+    if ((gate.gate_type == GateType::Existential || gate.gate_type == GateType::Universal) && nr_output_gates[alias] == 0 && alias != output_alias) {
+      number_variables[(gate.gate_type == GateType::Existential) ? 0 : 1]--;
+      gate.gate_type = GateType::None;
+      nr_removed_variables++;
+    }
+  }
+  if (verbose) {
+    std::cerr << "Simplification removed " << nr_removed_gates << " gates and " << nr_removed_variables << " variables." << std::endl;
+  }
+  return nr_removed_gates + nr_removed_variables;
+}
+
+const vector<GatePolarity>& QBFParser::getGatePolarities(GatePolarity output_polarity) {
+  auto& polarity = polarity_cache[static_cast<int>(output_polarity)];
+  if (!polarity.empty()) {
+    return polarity;
   }
+  // Gates are visited after all gates they are an input to.
+  auto& gates_ordered = gateTopologicalOrdering();
   polarity.resize(gates.size(), GatePolarity::None);
   auto output_alias = id_to_alias[output_id];
   polarity[output_alias] = output_polarity;
-  vector<int> queue = {output_alias};
-  while (!queue.empty()) {
-    auto alias = queue.back();
+  for (auto it = gates_ordered.rbegin(); it != gates_ordered.rend(); it++) {
+    auto alias = *it;
     auto& gate = gates[alias];
     assert(polarity[alias] != GatePolarity::None);
-    queue.pop_back();
     if (gate.gate_inputs != nullptr) {
       for (unsigned i = 0; i < gate.nr_inputs; i++) {
         auto& input_literal = gate.gate_inputs[i];
         auto variable_alias = abs(input_literal);
         auto child_polarity = input_literal > 0 ? polarity[alias] : -polarity[alias];
+        if (gate.gate_type == GateType::Xor || (gate.gate_type == GateType::Ite && i == 0)) {
+          // Inputs of XOR gates and the condition of ITE gates occur in both polarities.
+          child_polarity = GatePolarity::Both;
+        }
         assert(variable_alias < polarity.size());
         polarity[variable_alias] = polarity[variable_alias] + child_polarity;
         assert(polarity[variable_alias] != GatePolarity::None);
-        nr_output_gates[variable_alias]--;
-        if (nr_output_gates[variable_alias] == 0 && (gates[variable_alias].gate_type == GateType::And || gates[variable_alias].gate_type == GateType::Or)) {
-          queue.push_back(variable_alias);
-        }
       }
     }
   }
+  return polarity;
 }
 
-void QBFParser::addToClauseList(int alias, const GatePolarity polarity, vector<vector<int>>& clause_list) {
+void QBFParser::addToClauseList(int alias, const GatePolarity polarity, ClauseSink& sink) {
   auto& gate = gates[alias];
-  if (gate.gate_type != GateType::And && gate.gate_type != GateType::Or) {
+  if (gate.gate_type == GateType::Xor || gate.gate_type == GateType::Ite) {
+    addXorIteClauses(alias, polarity, sink);
+    return;
+  } else if (gate.gate_type != GateType::And && gate.gate_type != GateType::Or) {
     return;
   }
   for (unsigned i = 0; i < gate.nr_inputs; i++) {
     auto input_literal = gate.gate_inputs[i];
     if (gate.gate_type == GateType::And && polarity != GatePolarity::Negative) {
       // AND: input_literal false forces output false | add if polarity not negative
-      clause_list.push_back(vector<int> {input_literal, -alias});
+      sink.addClause({input_literal, -alias});
     } else if (gate.gate_type == GateType::Or && polarity != GatePolarity::Positive) {
       // OR: input_literal_true forces output true | add if polarity not positive
-      clause_list.push_back(vector<int> {-input_literal, alias});
+      sink.addClause({-input_literal, alias});
     }
   }
   // AND: all input_literals true enforces true -> clause -gate_inputs or alias | add if polarity not positive
   if (gate.gate_type == GateType::And && polarity != GatePolarity::Positive) {
     vector<int> large_gate_clause;
+    large_gate_clause.reserve(gate.nr_inputs + 1);
     for (unsigned i = 0; i < gate.nr_inputs; i++) {
       auto input_literal = gate.gate_inputs[i];
       large_gate_clause.push_back(-input_literal);
     }
     large_gate_clause.push_back(alias);
-    clause_list.push_back(large_gate_clause);
+    sink.addClause(large_gate_clause);
   }
   // OR: all input_literals false enforce false -> clause gate_inputs or -alias | add if polarity not negative
   if (gate.gate_type == GateType::Or && polarity != GatePolarity::Negative) {
     vector<int> large_gate_clause(gate.gate_inputs, gate.gate_inputs + gate.nr_inputs);
     large_gate_clause.push_back(-alias);
-    clause_list.push_back(large_gate_clause);
+    sink.addClause(large_gate_clause);
+  }
+}
+
+void QBFParser::addXorIteClauses(int alias, const GatePolarity polarity, ClauseSink& sink) {
+  // Two clauses per direction, instead of an encoding in terms of AND/OR gates.
+  auto& gate = gates[alias];
+  if (gate.gate_type == GateType::Xor) {
+    assert(gate.nr_inputs == 2);
+    auto first = gate.gate_inputs[0];
+    auto second = gate.gate_inputs[1];
+    if (polarity != GatePolarity::Negative) {
+      // XOR true forces the inputs to differ.
+      sink.addClause({first, second, -alias});
+      sink.addClause({-first, -second, -alias});
+    }
+    if (polarity != GatePolarity::Positive) {
+      // XOR false forces the inputs to be equal.
+      sink.addClause({-first, second, alias});
+      sink.addClause({first, -second, alias});
+    }
+  } else {
+    assert(gate.nr_inputs == 3);
+    auto condition = gate.gate_inputs[0];
+    auto then_literal = gate.gate_inputs[1];
+    auto else_literal = gate.gate_inputs[2];
+    if (polarity != GatePolarity::Negative) {
+      // ITE true forces the selected branch true.
+      sink.addClause({-condition, then_literal, -alias});
+      sink.addClause({condition, else_literal, -alias});
+    }
+    if (polarity != GatePolarity::Positive) {
+      // ITE false forces the selected branch false.
+      sink.addClause({-condition, -then_literal, alias});
+      sink.addClause({condition, -else_literal, alias});
+    }
   }
 }
 
-void QBFParser::addOutputUnit(bool negate, vector<vector<int>>& clause_list) {
+void QBFParser::addOutputUnit(bool negate, ClauseSink& sink) {
  if (negate) {
-    clause_list.push_back({-id_to_alias[output_id]});
+    sink.addClause({-id_to_alias[output_id]});
   } else {
-    clause_list.push_back({id_to_alias[output_id]});
+    sink.addClause({id_to_alias[output_id]});
   }
 }
 
-vector<vector<int>> QBFParser::getMatrix(bool negate, bool tseitin) {
-  GatePolarity output_polarity;
+GatePolarity QBFParser::getOutputPolarity(bool negate, bool tseitin) {
   if (tseitin) {
-    output_polarity = GatePolarity::Both;
+    return GatePolarity::Both;
   } else if (negate) {
-    output_polarity = GatePolarity::Negative;
+    return GatePolarity::Negative;
   } else {
-    output_polarity = GatePolarity::Positive;
+    return GatePolarity::Positive;
   }
-  vector<GatePolarity> polarity;
-  getGatePolarities(polarity, output_polarity);
-  vector<vector<int>> clause_list;
+}
+
+void QBFParser::addMatrixClauses(bool negate, const vector<GatePolarity>& polarity, ClauseSink& sink) {
   for (unsigned alias = 1; alias < gates.size(); alias++) {
-    addToClauseList(alias, polarity[alias], clause_list);
+    addToClauseList(alias, polarity[alias], sink);
   }
-  addOutputUnit(negate, clause_list);
+  addOutputUnit(negate, sink);
+}
+
+ClauseArena QBFParser::getMatrix(bool negate, bool tseitin) {
+  PhaseTimer matrix_timer(statistics, "matrix");
+  auto& polarity = getGatePolarities(getOutputPolarity(negate, tseitin));
+  ClauseArena clause_list;
+  addMatrixClauses(negate, polarity, clause_list);
   assert(clausesOK(clause_list));
   return clause_list;
 }
 
-bool QBFParser::clausesOK(vector<vector<int>>& clause_list) {
-  for (auto& clause: clause_list) {
+bool QBFParser::clausesOK(const ClauseArena& clause_list) {
+  for (auto clause: clause_list) {
     for (auto l: clause) {
       if (abs(l) > getMaxVariableInt()) {
         return false;
@@ -248,12 +578,10 @@ bool QBFParser::clausesOK(vector<vector<int>>& clause_list) {
   return true;
 }
 
-vector<vector<int>> QBFParser::getDefinitionClauses() {
-  vector<vector<int>> definition_clauses;
+void QBFParser::getDefinitionClauses(ClauseSink& sink) {
   for (int alias: definition_aliases) {
-    addToClauseList(alias, GatePolarity::Both, definition_clauses);
+    addToClauseList(alias, GatePolarity::Both, sink);
   }
-  return definition_clauses;
 }
 
 int QBFParser::getMaxVariableInt() {
@@ -265,6 +593,7 @@ int QBFParser::numberVariables(VariableType type) {
 }
 
 void QBFParser::addDefinitions(vector<tuple<vector<int>,int>>& definitions, vector<int>& defined_variables) {
+  PhaseTimer definitions_timer(statistics, "definitions");
   for (const auto& defined_alias: defined_variables) {
     defined_ids.push_back(gates[defined_alias].gate_id);
   }
@@ -279,34 +608,123 @@ auto QBFParser::getDefinitionsFor(Extractor& extractor, VariableType type) {
   int max_variable_int = getMaxVariableInt();
   auto [shared_variables, query_variables, query_mask] = getQueryVariableSets(type);
   auto [defined, definitions] = extractor.getDefinitions(propositional_matrix, query_variables, shared_variables, query_mask, max_variable_int);
-  float fraction = float(defined.size()) / float(numberVariables(type));
-  string qtype_string_long = (type == VariableType::Universal) ? "universal" : "existential";
-  std::cerr << "Found " << defined.size() << " out of " << numberVariables(type) << " " << qtype_string_long << " variables uniquely determined (" << fraction << ")." << std::endl;
+  printNumberDefined(defined.size(), type);
   return std::make_tuple(defined, definitions);
 }
 
+void QBFParser::printNumberDefined(unsigned int nr_defined, VariableType type) {
+  if (!verbose) {
+    return;
+  }
+  float fraction = float(nr_defined) / float(numberVariables(type));
+  string qtype_string_long = (type == VariableType::Universal) ? "universal" : "existential";
+  std::cerr << "Found " << nr_defined << " out of " << numberVariables(type) << " " << qtype_string_long << " variables uniquely determined (" << fraction << ")." << std::endl;
+}
+
+void QBFParser::getConcurrentDefinitions(Extractor& extractor, vector<int>& defined_existentials, vector<definition>& definitions_existentials, vector<int>& defined_universals, vector<definition>& definitions_universals) {
+  // The parser is not thread-safe, so both matrices and query sets are built before the universal pass starts.
+  int max_variable_int = getMaxVariableInt();
+  auto existential_matrix = getMatrix(false);
+  auto [existential_shared, existential_queries, existential_mask] = getQueryVariableSets(VariableType::Existential);
+  auto universal_matrix = getMatrix(true);
+  // Captured by the thread, so no structured binding.
+  vector<int> universal_shared, universal_queries;
+  vector<bool> universal_mask;
+  std::tie(universal_shared, universal_queries, universal_mask) = getQueryVariableSets(VariableType::Universal);
+
+  // The universal pass gets its own statistics and definition circuit, they are merged after the existential ones.
+  auto universal_statistics = statistics ? std::make_unique<Statistics>() : nullptr;
+  auto universal_circuit = definition_circuit ? std::make_unique<DefinitionCircuit>() : nullptr;
+  universal_extractor->setStatistics(universal_statistics.get());
+  universal_extractor->setDefinitionCircuit(universal_circuit.get());
+  auto auxiliary_start = extractor.getAuxiliaryStart();
+  universal_extractor->setAuxiliaryStart(auxiliary_start);
+
+  std::exception_ptr existential_exception, universal_exception;
+  std::thread universal_thread([&]() {
+    // Signals are handled on the main thread, which interrupts both extractors.
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    try {
+      std::tie(defined_universals, definitions_universals) = universal_extractor->getDefinitions(universal_matrix, universal_queries, universal_shared, universal_mask, max_variable_int);
+    }
+    catch (...) {
+      universal_exception = std::current_exception();
+    }
+  });
+  try {
+    std::tie(defined_existentials, definitions_existentials) = extractor.getDefinitions(existential_matrix, existential_queries, existential_shared, existential_mask, max_variable_int);
+  }
+  catch (...) {
+    existential_exception = std::current_exception();
+  }
+  universal_thread.join();
+  universal_extractor->setStatistics(nullptr);
+  universal_extractor->setDefinitionCircuit(nullptr);
+  for (auto exception: { existential_exception, universal_exception }) {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+
+  // Both passes numbered their auxiliary variables from the same start. The universal ones are moved behind the
+  // existential ones, where a sequential run would have put them.
+  int shift = std::max(max_variable_int, extractor.getAuxiliaryStart()) - std::max(max_variable_int, auxiliary_start);
+  auto shift_literal = [max_variable_int, shift](int& literal) {
+    if (abs(literal) > max_variable_int) {
+      literal += (literal > 0) ? shift : -shift;
+    }
+  };
+  for (auto& [input_literals, output_alias]: definitions_universals) {
+    std::for_each(input_literals.begin(), input_literals.end(), shift_literal);
+    shift_literal(output_alias);
+  }
+  extractor.setAuxiliaryStart(std::max(extractor.getAuxiliaryStart(), universal_extractor->getAuxiliaryStart() + shift));
+  if (statistics) {
+    statistics->merge(*universal_statistics);
+  }
+  if (definition_circuit) {
+    definition_circuit->append(*universal_circuit);
+  }
+  printNumberDefined(defined_existentials.size(), VariableType::Existential);
+  printNumberDefined(defined_universals.size(), VariableType::Universal);
+}
+
 tuple<vector<int>, vector<int>, vector<bool>> QBFParser::getQueryVariableSets(VariableType type) {
   vector<int> defining_variables;
   GateType variable_type = (type == VariableType::Universal) ? GateType::Universal : GateType::Existential;
+  // Variables removed by simplify are skipped, they do not end a quantifier block.
+  auto removed = [this](unsigned int alias) {
+    return gates[alias].gate_type == GateType::None;
+  };
   unsigned int alias = 1;
   if (type == VariableType::Universal) {
     // Don't look for unique Herbrand functions of outermost universals.
-    for (; alias < variable_gate_boundary && gates[alias].gate_type == GateType::Universal; alias++) {
-      defining_variables.push_back(alias);
+    for (; alias < variable_gate_boundary && (gates[alias].gate_type == GateType::Universal || removed(alias)); alias++) {
+      if (!removed(alias)) {
+        defining_variables.push_back(alias);
+      }
     }
   }
   for (; alias < variable_gate_boundary && gates[alias].gate_type != variable_type; alias++) {
-    defining_variables.push_back(alias);
+    if (!removed(alias)) {
+      defining_variables.push_back(alias);
+    }
   }
   // All remaining variables go into the query variables.
   vector<std::tuple<int, string, bool>> query_tuples;
 
   for (; alias < variable_gate_boundary; alias++) {
-    query_tuples.emplace_back(alias, gates[alias].gate_id, gates[alias].gate_type == variable_type);
+    if (!removed(alias)) {
+      query_tuples.emplace_back(alias, gates[alias].gate_id, gates[alias].gate_type == variable_type);
+    }
   }
 
   if (comparator != nullptr) {
     std::sort(query_tuples.begin(), query_tuples.end(), *comparator);
+  } else if (ordering_strategy != OrderingStrategy::Input) {
+    std::sort(query_tuples.begin(), query_tuples.end(), ScoreComparator(getOrderingScores(ordering_strategy)));
   }
 
   vector<int> query_variables;
@@ -321,20 +739,35 @@ tuple<vector<int>, vector<int>, vector<bool>> QBFParser::getQueryVariableSets(Va
 }
 
 void QBFParser::getDefinitions(Extractor& extractor) {
+  extractor.setDefinitionCircuit(definition_circuit.get());
   doGetDefinitions(extractor);
+  extractor.setDefinitionCircuit(nullptr);
+  if (statistics) {
+    statistics->nameVariables([this](int alias) { return gates[alias].gate_id; });
+  }
 }
 
 void QBFParser::doGetDefinitions(Extractor& extractor) {
-  auto [defined_existentials, definitions_existentials] = getDefinitionsFor(extractor, VariableType::Existential);
-  auto [defined_universals, definitions_universals] = getDefinitionsFor(extractor, VariableType::Universal);
+  vector<int> defined_existentials, defined_universals;
+  vector<definition> definitions_existentials, definitions_universals;
+  if (universal_extractor) {
+    getConcurrentDefinitions(extractor, defined_existentials, definitions_existentials, defined_universals, definitions_universals);
+  } else {
+    std::tie(defined_existentials, definitions_existentials) = getDefinitionsFor(extractor, VariableType::Existential);
+    std::tie(defined_universals, definitions_universals) = getDefinitionsFor(extractor, VariableType::Universal);
+  }
 
   if (defined_existentials.size() > 0) {
-    std::cerr << "Processing existential definitions. " << std::endl;
+    if (verbose) {
+      std::cerr << "Processing existential definitions. " << std::endl;
+    }
     addDefinitions(definitions_existentials, defined_existentials);
   }
 
   if (defined_universals.size() > 0) {
-    std::cerr << "Processing universal definitions. " << std::endl;
+    if (verbose) {
+      std::cerr << "Processing universal definitions. " << std::endl;
+    }
     addDefinitions(definitions_universals, defined_universals);
   }
 }
@@ -372,6 +805,17 @@ void QBFParser::addDefinition(vector<int>& input_literals, int output_alias) {
   gate.gate_inputs = new int[input_literals.size()];
   std::copy(input_literals.begin(), input_literals.end(), gate.gate_inputs);
   gate.nr_inputs = input_literals.size();
+  // Keep fan-out counts up to date, ordering and polarities are recomputed on demand.
+  if (fanout_counts_valid) {
+    fanout_counts.resize(gates.size(), 0);
+    for (auto input_literal: input_literals) {
+      fanout_counts[abs(input_literal)]++;
+    }
+  }
+  topological_order_valid = false;
+  for (auto& polarity: polarity_cache) {
+    polarity.clear();
+  }
 }
 
 bool QBFParser::isNumber(const string& s)
@@ -379,42 +823,167 @@ bool QBFParser::isNumber(const string& s)
   return !s.empty() && std::find_if(s.begin(), s.end(), [](char c) { return !std::isdigit(c); }) == s.end();
 }
 
-vector<int> QBFParser::gateTopologicalOrdering() {
-  vector<int> nr_output_gates(gates.size(), 0);
-  for (unsigned i = 1; i < gates.size(); i++) {
-    auto& gate = gates[i];
-    if (gate.gate_type == GateType::And || gate.gate_type == GateType::Or) {
-      for (unsigned i = 0; i < gate.nr_inputs; i++) {
-        auto variable_alias = abs(gate.gate_inputs[i]);
-        nr_output_gates[variable_alias]++;
-      }
-    }
+const vector<int>& QBFParser::gateTopologicalOrdering() {
+  if (topological_order_valid) {
+    return topological_order;
   }
-  vector<int> gates_ordered;
+  vector<int> nr_output_gates = getFanoutCounts();
+  topological_order.clear();
   auto output_alias = id_to_alias[output_id];
   vector<int> queue = {output_alias};
   while (!queue.empty()) {
     auto alias = queue.back();
     queue.pop_back();
-    gates_ordered.push_back(alias);
+    topological_order.push_back(alias);
     auto& gate = gates[alias];
     if (gate.gate_inputs != nullptr) {
       for (unsigned i = 0; i < gate.nr_inputs; i++) {
         auto variable_alias = abs(gate.gate_inputs[i]);
         nr_output_gates[variable_alias]--;
-        if (nr_output_gates[variable_alias] == 0 && (gates[variable_alias].gate_type == GateType::And || gates[variable_alias].gate_type == GateType::Or)) {
+        if (nr_output_gates[variable_alias] == 0 && isGateType(gates[variable_alias].gate_type)) {
           queue.push_back(variable_alias);
         }
       }
     }
   }
-  std::reverse(gates_ordered.begin(), gates_ordered.end());
-  return gates_ordered;
+  std::reverse(topological_order.begin(), topological_order.end());
+  topological_order_valid = true;
+  return topological_order;
+}
+
+bool QBFParser::isGateType(const GateType& gate_type) {
+  return gate_type == GateType::And || gate_type == GateType::Or || gate_type == GateType::Xor || gate_type == GateType::Ite;
+}
+
+bool QBFParser::isClauseGate(const Gate& gate) {
+  if (gate.gate_type != GateType::Or) {
+    return false;
+  }
+  for (unsigned i = 0; i < gate.nr_inputs; i++) {
+    if (abs(gate.gate_inputs[i]) >= variable_gate_boundary) {
+      return false;
+    }
+  }
+  return true;
+}
+
+vector<long> QBFParser::getOrderingScores(OrderingStrategy strategy) {
+  // Scores are indexed by alias, variables with higher scores are checked first.
+  vector<long> scores(gates.size(), 0);
+  if (strategy == OrderingStrategy::Occurrence) {
+    // Number of gates a variable occurs in.
+    auto& nr_output_gates = getFanoutCounts();
+    for (int variable = 1; variable < variable_gate_boundary; variable++) {
+      scores[variable] = nr_output_gates[variable];
+    }
+  } else if (strategy == OrderingStrategy::Cone) {
+    // Variables with a small cone of influence (transitive fan-out) come first.
+    vector<unsigned> fanout_start(gates.size() + 1, 0);
+    for (unsigned alias = variable_gate_boundary; alias < gates.size(); alias++) {
+      auto& gate = gates[alias];
+      if (isGateType(gate.gate_type)) {
+        for (unsigned i = 0; i < gate.nr_inputs; i++) {
+          fanout_start[abs(gate.gate_inputs[i]) + 1]++;
+        }
+      }
+    }
+    for (unsigned alias = 1; alias <= gates.size(); alias++) {
+      fanout_start[alias] += fanout_start[alias - 1];
+    }
+    vector<int> fanout(fanout_start.back());
+    vector<unsigned> fanout_end(fanout_start.begin(), fanout_start.end() - 1);
+    for (unsigned alias = variable_gate_boundary; alias < gates.size(); alias++) {
+      auto& gate = gates[alias];
+      if (isGateType(gate.gate_type)) {
+        for (unsigned i = 0; i < gate.nr_inputs; i++) {
+          fanout[fanout_end[abs(gate.gate_inputs[i])]++] = alias;
+        }
+      }
+    }
+    vector<int> visited(gates.size(), 0);
+    vector<int> stack;
+    for (int variable = 1; variable < variable_gate_boundary; variable++) {
+      long cone_size = 0;
+      stack.push_back(variable);
+      while (!stack.empty()) {
+        auto alias = stack.back();
+        stack.pop_back();
+        for (unsigned j = fanout_start[alias]; j < fanout_start[alias + 1]; j++) {
+          auto output_alias = fanout[j];
+          if (visited[output_alias] != variable) {
+            visited[output_alias] = variable;
+            cone_size++;
+            stack.push_back(output_alias);
+          }
+        }
+      }
+      scores[variable] = -cone_size;
+    }
+  } else if (strategy == OrderingStrategy::Depth) {
+    // Longest path from the output to a variable, deep variables come first.
+    auto& gates_ordered = gateTopologicalOrdering();
+    for (auto it = gates_ordered.rbegin(); it != gates_ordered.rend(); it++) {
+      auto& gate = gates[*it];
+      for (unsigned i = 0; i < gate.nr_inputs; i++) {
+        auto input_alias = abs(gate.gate_inputs[i]);
+        scores[input_alias] = std::max(scores[input_alias], scores[*it] + 1);
+      }
+    }
+  } else if (strategy == OrderingStrategy::Gates) {
+    // Look for variables that are outputs of AND/OR definitions encoded in clauses, such as
+    // (x, -a, -b), (-x, a), (-x, b). These come first, remaining variables are ordered by
+    // the number of binary clauses they occur in.
+    std::unordered_set<uint64_t> binary_clauses;
+    auto binary_key = [](int first, int second) {
+      if (first > second) {
+        std::swap(first, second);
+      }
+      // Literals are packed as unsigned values, shifting a negative value is undefined.
+      return (uint64_t(uint32_t(first)) << 32) | uint32_t(second);
+    };
+    for (unsigned alias = variable_gate_boundary; alias < gates.size(); alias++) {
+      auto& gate = gates[alias];
+      if (isClauseGate(gate) && gate.nr_inputs == 2) {
+        binary_clauses.insert(binary_key(gate.gate_inputs[0], gate.gate_inputs[1]));
+        scores[abs(gate.gate_inputs[0])]++;
+        scores[abs(gate.gate_inputs[1])]++;
+      }
+    }
+    vector<bool> gate_output(variable_gate_boundary, false);
+    for (unsigned alias = variable_gate_boundary; alias < gates.size(); alias++) {
+      auto& gate = gates[alias];
+      if (!isClauseGate(gate) || gate.nr_inputs < 2) {
+        continue;
+      }
+      for (unsigned i = 0; i < gate.nr_inputs; i++) {
+        auto output_literal = gate.gate_inputs[i];
+        if (gate_output[abs(output_literal)]) {
+          continue;
+        }
+        bool is_output = true;
+        for (unsigned j = 0; j < gate.nr_inputs && is_output; j++) {
+          if (j != i) {
+            is_output = binary_clauses.count(binary_key(-output_literal, -gate.gate_inputs[j])) > 0;
+          }
+        }
+        gate_output[abs(output_literal)] = is_output;
+      }
+    }
+    // Gate outputs are raised above the highest binary clause count, so that they come first and keep their order
+    // by binary clause counts among themselves.
+    long gate_output_offset = 1 + *std::max_element(scores.begin(), scores.end());
+    for (int variable = 1; variable < variable_gate_boundary; variable++) {
+      if (gate_output[variable]) {
+        scores[variable] += gate_output_offset;
+      }
+    }
+  }
+  return scores;
 }
 
 void QBFParser::writeQCIR(const string& filename) {
-  std::ofstream out(filename);
-  if (out) {
+  OutputBuffer out(filename);
+  if (out.good()) {
     doWriteQCIR(out);
   } else {
     std::cerr << "Error opening file: " << filename << std::endl;
@@ -422,40 +991,69 @@ void QBFParser::writeQCIR(const string& filename) {
 }
 
 void QBFParser::writeQCIR() {
-  doWriteQCIR(std::cout);
+  OutputBuffer out(std::cout);
+  doWriteQCIR(out);
 }
 
-void QBFParser::doWriteQDIMACS(std::ostream& out) {
-  auto matrix_clauses = getMatrix(false);
-  out << "c defined variables: ";
-  std::copy(defined_ids.begin(), defined_ids.end(), std::ostream_iterator<string>(out, " "));
-  out << std::endl;
-  out << "p cnf " << max_id_number << " " << matrix_clauses.size() << std::endl;
-  printQDIMACSPrefix(out);
-  printClauselist(matrix_clauses, out);
+void QBFParser::writeQCIR(std::ostream& out) {
+  OutputBuffer buffer(out);
+  doWriteQCIR(buffer);
 }
 
-void QBFParser::doWriteDIMACS(std::ostream& out) {
-  auto definition_clauses = getDefinitionClauses();
-  out << "c defined variables: ";
-  std::copy(defined_ids.begin(), defined_ids.end(), std::ostream_iterator<string>(out, " "));
-  out << std::endl;
-  out << "p cnf " << max_id_number << " " << definition_clauses.size() << std::endl;
-  printClauselist(definition_clauses, out);
+void QBFParser::writeQCIR(OutputBuffer& out) {
+  doWriteQCIR(out);
 }
 
-void QBFParser::printClauselist(vector<vector<int>>& clause_list, std::ostream& out) {
-  for (auto& clause: clause_list) {
-    for (auto& literal: clause) {
-      auto alias = abs(literal);
-      auto sign = (literal > 0) ? "" : "-";
-      out << sign << gates[alias].gate_id << " ";
+/* Prints clauses in terms of the original variable ids as they are generated. */
+class ClausePrinter: public ClauseSink {
+public:
+  ClausePrinter(OutputBuffer& out, const vector<Gate>& gates): out(out), gates(gates) {}
+
+protected:
+  void receiveClause(const int* literals, unsigned int size) override {
+    for (unsigned int i = 0; i < size; i++) {
+      if (literals[i] < 0) {
+        out << '-';
+      }
+      out << gates[abs(literals[i])].gate_id << ' ';
     }
-    out << "0" << std::endl;
+    out << "0\n";
+  }
+
+  OutputBuffer& out;
+  const vector<Gate>& gates;
+};
+
+void QBFParser::doWriteQDIMACS(OutputBuffer& out) {
+  // Two passes over the gates (count, then print) instead of materializing the matrix.
+  auto& polarity = getGatePolarities(GatePolarity::Positive);
+  ClauseCounter counter;
+  addMatrixClauses(false, polarity, counter);
+  out << "c defined variables: ";
+  for (auto& id: defined_ids) {
+    out << id << ' ';
+  }
+  out << '\n';
+  out << "p cnf " << max_id_number << " " << counter.nr_clauses << '\n';
+  printQDIMACSPrefix(out);
+  ClausePrinter printer(out, gates);
+  addMatrixClauses(false, polarity, printer);
+}
+
+void QBFParser::doWriteDIMACS(OutputBuffer& out) {
+  ClauseCounter counter;
+  getDefinitionClauses(counter);
+  out << "c defined variables: ";
+  for (auto& id: defined_ids) {
+    out << id << ' ';
   }
+  out << '\n';
+  out << "p cnf " << max_id_number << " " << counter.nr_clauses << '\n';
+  ClausePrinter printer(out, gates);
+  getDefinitionClauses(printer);
 }
 
-void QBFParser::printQDIMACSPrefix(std::ostream& out) {
+void QBFParser::printQDIMACSPrefix(OutputBuffer& out) {
   GateType last_block_type = GateType::None;
   bool first_variable_seen = false;
   for (unsigned i = 1; i < variable_gate_boundary; i++) {
@@ -464,7 +1062,7 @@ void QBFParser::printQDIMACSPrefix(std::ostream& out) {
       if (gate.gate_type != last_block_type) { 
         last_block_type = gate.gate_type;
         if (first_variable_seen) {
-          out << "0" << std::endl; // Close last block unless this is the first variable.
+          out << "0" << '\n'; // Close last block unless this is the first variable.
         }
         auto block_start_string = (gate.gate_type == GateType::Existential) ? 'e' : 'a';
         out << block_start_string << " ";  // "Open" a new quantifier block.
@@ -473,24 +1071,28 @@ void QBFParser::printQDIMACSPrefix(std::ostream& out) {
       first_variable_seen = true;
     }
   }
-  if (last_block_type == GateType::Universal) {
-    out << "0" << std::endl;
-    out << "e "; // Open new quantifier block for Tseitin variables.
-  }
   for (unsigned alias = 1; alias < gates.size(); alias++) {
     auto& gate = gates[alias];
-    if (gate.gate_type == GateType::And || gate.gate_type == GateType::Or) {
+    if (isGateType(gate.gate_type)) {
+      if (last_block_type != GateType::Existential) {
+        if (first_variable_seen) {
+          out << "0" << '\n';
+        }
+        out << "e "; // Open new quantifier block for Tseitin variables.
+        last_block_type = GateType::Existential;
+        first_variable_seen = true;
+      }
       out << gate.gate_id << " ";
     }
   }
   if (first_variable_seen) {
-    out << "0" << std::endl;
+    out << "0" << '\n';
   }
 }
 
 void QBFParser::writeQDIMACS(const string& filename) {
-  std::ofstream out(filename);
-  if (out) {
+  OutputBuffer out(filename);
+  if (out.good()) {
     doWriteQDIMACS(out);
   } else {
     std::cerr << "Error opening file: " << filename << std::endl;
@@ -498,12 +1100,22 @@ void QBFParser::writeQDIMACS(const string& filename) {
 }
 
 void QBFParser::writeQDIMACS() {
-  doWriteQDIMACS(std::cout);
+  OutputBuffer out(std::cout);
+  doWriteQDIMACS(out);
+}
+
+void QBFParser::writeQDIMACS(std::ostream& out) {
+  OutputBuffer buffer(out);
+  doWriteQDIMACS(buffer);
+}
+
+void QBFParser::writeQDIMACS(OutputBuffer& out) {
+  doWriteQDIMACS(out);
 }
 
 void QBFParser::writeDIMACS(const string& filename) {
-  std::ofstream out(filename);
-  if (out) {
+  OutputBuffer out(filename);
+  if (out.good()) {
     doWriteDIMACS(out);
   } else {
     std::cerr << "Error opening file: " << filename << std::endl;
@@ -511,11 +1123,21 @@ void QBFParser::writeDIMACS(const string& filename) {
 }
 
 void QBFParser::writeDIMACS() {
-  doWriteDIMACS(std::cout);
+  OutputBuffer out(std::cout);
+  doWriteDIMACS(out);
+}
+
+void QBFParser::writeDIMACS(std::ostream& out) {
+  OutputBuffer buffer(out);
+  doWriteDIMACS(buffer);
+}
+
+void QBFParser::writeDIMACS(OutputBuffer& out) {
+  doWriteDIMACS(out);
 }
 
-void QBFParser::printQCIRPrefix(std::ostream& out) {
-  out << "#QCIR-G14" << std::endl; // Print "preamble".
+void QBFParser::printQCIRPrefix(OutputBuffer& out) {
+  out << "#QCIR-G14" << '\n'; // Print "preamble".
   GateType last_block_type = GateType::None;
   bool first_variable_seen = false;
   for (unsigned i = 1; i < variable_gate_boundary; i++) {
@@ -524,7 +1146,7 @@ void QBFParser::printQCIRPrefix(std::ostream& out) {
       if (gate.gate_type != last_block_type) { 
         last_block_type = gate.gate_type;
         if (first_variable_seen) {
-          out << ')' << std::endl; // Close last block unless this is the first variable.
+          out << ')' << '\n'; // Close last block unless this is the first variable.
         }
         auto& block_start_string = (gate.gate_type == GateType::Existential) ? EXISTS_STRING : FORALL_STRING;
         out << block_start_string << '(' << gate.gate_id; // "Open" a new quantifier block.
@@ -535,14 +1157,14 @@ void QBFParser::printQCIRPrefix(std::ostream& out) {
     }
   }
   if (first_variable_seen) { // Close last block (if there were any quantified variables).
-    out << ')' << std::endl; 
+    out << ')' << '\n'; 
   }
-  out << "output(" << output_id << ')' << std::endl;
+  out << "output(" << output_id << ')' << '\n';
 }
 
-void QBFParser::printQCIRGate(Gate& gate, std::ostream& out) {
-  if (gate.gate_type == GateType::And || gate.gate_type == GateType::Or) {
-    auto& gate_type_string = (gate.gate_type == GateType::And) ? AND_STRING : OR_STRING;
+void QBFParser::printQCIRGate(Gate& gate, OutputBuffer& out) {
+  if (isGateType(gate.gate_type)) {
+    auto& gate_type_string = (gate.gate_type == GateType::And) ? AND_STRING : (gate.gate_type == GateType::Or) ? OR_STRING : (gate.gate_type == GateType::Xor) ? XOR_STRING : ITE_STRING;
     out << gate.gate_id << " = " << gate_type_string << '(';
     for (unsigned i = 0; i < gate.nr_inputs; i++) {
       if (i) {
@@ -553,25 +1175,25 @@ void QBFParser::printQCIRGate(Gate& gate, std::ostream& out) {
       auto sign_char = input_literal > 0 ? "" : "-";
       out << sign_char << gates[input_alias].gate_id;
     }
-    out << ')' << std::endl;
+    out << ')' << '\n';
   }
 }
 
-void QBFParser::printQCIRGates(std::ostream& out) {
-  vector<int> gates_ordered = gateTopologicalOrdering();
+void QBFParser::printQCIRGates(OutputBuffer& out) {
+  auto& gates_ordered = gateTopologicalOrdering();
   for (auto alias: gates_ordered) {
     printQCIRGate(gates[alias], out);
   }
 }
 
-void QBFParser::doWriteQCIR(std::ostream& out) {
+void QBFParser::doWriteQCIR(OutputBuffer& out) {
   printQCIRPrefix(out);
   printQCIRGates(out);
 }
 
 void QBFParser::writeVerilog(const string& filename) {
-  std::ofstream out(filename);
-  if (out) {
+  OutputBuffer out(filename);
+  if (out.good()) {
     doWriteVerilog(out);
   } else {
     std::cerr << "Error opening file: " << filename << std::endl;
@@ -579,10 +1201,101 @@ void QBFParser::writeVerilog(const string& filename) {
 }
 
 void QBFParser::writeVerilog() {
-  doWriteVerilog(std::cout);
+  OutputBuffer out(std::cout);
+  doWriteVerilog(out);
+}
+
+void QBFParser::writeVerilog(std::ostream& out) {
+  OutputBuffer buffer(out);
+  doWriteVerilog(buffer);
+}
+
+void QBFParser::writeVerilog(OutputBuffer& out) {
+  doWriteVerilog(out);
+}
+
+void QBFParser::writeAIGER(const string& filename) {
+  OutputBuffer out(filename);
+  if (out.good()) {
+    doWriteAIGER(out);
+  } else {
+    std::cerr << "Error opening file: " << filename << std::endl;
+  }
+}
+
+void QBFParser::writeAIGER() {
+  OutputBuffer out(std::cout);
+  doWriteAIGER(out);
+}
+
+void QBFParser::writeAIGER(std::ostream& out) {
+  OutputBuffer buffer(out);
+  doWriteAIGER(buffer);
+}
+
+void QBFParser::writeAIGER(OutputBuffer& out) {
+  doWriteAIGER(out);
+}
+
+void QBFParser::doWriteAIGER(OutputBuffer& out) {
+  // Defined variables are outputs, the variables their definitions depend on are inputs.
+  auto variable_name = [this](int alias) { return gates[alias].gate_id; };
+  if (definition_circuit) {
+    definition_circuit->writeAIGER(out, variable_name);
+  } else {
+    std::cerr << "No definition circuit available, writing empty AIGER file." << std::endl;
+    DefinitionCircuit().writeAIGER(out, variable_name);
+  }
+}
+
+vector<int> QBFParser::numericIds() {
+  // Number of each alias, ids that are not positive integers (or do not fit an int) get fresh numbers.
+  vector<int> numbers(gates.size(), 0);
+  auto is_numeric = [](const string& id) {
+    return !id.empty() && id.size() < 10 && id[0] != '0' && std::all_of(id.begin(), id.end(), [](char c) { return c >= '0' && c <= '9'; });
+  };
+  int max_number = 0;
+  for (unsigned alias = 1; alias < gates.size(); alias++) {
+    if (is_numeric(gates[alias].gate_id)) {
+      numbers[alias] = std::stoi(gates[alias].gate_id);
+      max_number = std::max(max_number, numbers[alias]);
+    }
+  }
+  for (unsigned alias = 1; alias < gates.size(); alias++) {
+    if (numbers[alias] == 0) {
+      numbers[alias] = ++max_number;
+    }
+  }
+  return numbers;
+}
+
+vector<int> QBFParser::getDefinedVariables() {
+  auto numbers = numericIds();
+  vector<int> defined_variables;
+  for (auto& id: defined_ids) {
+    defined_variables.push_back(numbers[abs(id_to_alias.at(id))]);
+  }
+  return defined_variables;
+}
+
+vector<definition> QBFParser::getDefinitionGates() {
+  // AND gates in terms of numbers (see numericIds), in topological order.
+  auto numbers = numericIds();
+  vector<definition> definition_gates;
+  for (int alias: definition_aliases) {
+    auto& gate = gates[alias];
+    vector<int> input_literals;
+    for (unsigned i = 0; i < gate.nr_inputs; i++) {
+      int input_literal = gate.gate_inputs[i];
+      int input_number = numbers[abs(input_literal)];
+      input_literals.push_back(input_literal > 0 ? input_number : -input_number);
+    }
+    definition_gates.push_back(std::make_tuple(input_literals, numbers[alias]));
+  }
+  return definition_gates;
 }
 
-void QBFParser::doWriteVerilog(std::ostream& out) {
+void QBFParser::doWriteVerilog(OutputBuffer& out) {
   // Only works for 2QBF at the moment.
   vector<string> input_ids, output_ids, auxiliary_ids;
   for (unsigned i = 1; i < variable_gate_boundary; i++) {
@@ -605,29 +1318,29 @@ void QBFParser::doWriteVerilog(std::ostream& out) {
   paste(out, input_ids, ", ");
   out << ", ";
   paste(out, output_ids, ", ");
-  out << ");" << std::endl;
+  out << ");" << '\n';
   if (input_ids.size()) {
     out << "input ";
     paste(out, input_ids, ", ");
-    out << ";" << std::endl;
+    out << ";" << '\n';
   }
   out << "output ";
   paste(out, output_ids, ", ");
-  out << ";" << std::endl;
+  out << ";" << '\n';
   if (auxiliary_ids.size()) {
     out << "wire ";
     paste(out, auxiliary_ids, ", ");
-    out << ";" << std::endl;
+    out << ";" << '\n';
   }
   for (const int& alias: definition_aliases) {
-    printAndOrGateVerilog(out, alias);
+    printGateVerilog(out, alias);
   }
-  out << "endmodule" << std::endl;
+  out << "endmodule" << '\n';
 }
 
-void QBFParser::printAndOrGateVerilog(std::ostream& out, const int alias) {
+void QBFParser::printGateVerilog(OutputBuffer& out, const int alias) {
   const auto& gate = gates[alias];
-  assert(gate.gate_type == GateType::Or || gate.gate_type == GateType::And);
+  assert(isGateType(gate.gate_type));
   out << "assign " << "v_" + gate.gate_id << " = ";
   if (gate.nr_inputs > 0) {
     vector<string> gate_input_strings;
@@ -637,15 +1350,19 @@ void QBFParser::printAndOrGateVerilog(std::ostream& out, const int alias) {
       string sign_string = input_literal > 0 ? "" : "~";
       gate_input_strings.push_back(sign_string + "v_" + gates[input_alias].gate_id);
     }
-    string separator = (gate.gate_type == GateType::And ? " & ": " | ");
-    paste(out, gate_input_strings, separator);
+    if (gate.gate_type == GateType::Ite) {
+      out << gate_input_strings[0] << " ? " << gate_input_strings[1] << " : " << gate_input_strings[2];
+    } else {
+      string separator = (gate.gate_type == GateType::And ? " & " : gate.gate_type == GateType::Or ? " | " : " ^ ");
+      paste(out, gate_input_strings, separator);
+    }
   } else { // No inputs, simplifies to constant;
     out << (gate.gate_type == GateType::And ? "1": "0");
   }
-  out << ";" << std::endl;
+  out << ";" << '\n';
 }
 
-template<typename T> void QBFParser::paste(std::ostream& out, vector<T>& arguments, const string& separator) {
+template<typename T> void QBFParser::paste(OutputBuffer& out, vector<T>& arguments, const string& separator) {
   for (unsigned i = 0; i < arguments.size(); i++) {
     if (i > 0) {
       out << separator;
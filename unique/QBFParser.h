@@ -6,10 +6,16 @@
 #include <string>
 #include <tuple>
 #include <iostream>
+#include <memory>
 #include <tuple>
 
 #include "extractor.h"
 #include "VariableComparator.h"
+#include "Statistics.h"
+#include "OutputBuffer.h"
+#include "DefinitionCircuit.h"
+#include "ClauseSink.h"
+#include "ClauseArena.h"
 
 using std::vector;
 using std::string;
@@ -19,9 +25,12 @@ using std::unordered_map;
 typedef tuple<vector<int>,int> definition;
 
 enum class VariableType: int8_t { Existential = 0, Universal = 1};
-enum class GateType { None, Existential, Universal, And, Or };
+enum class GateType { None, Existential, Universal, And, Or, Xor, Ite };
 enum class GatePolarity: int { None = 0, Positive = 1, Negative = 2, Both = 3};
 
+typedef tuple<VariableType, vector<int>> quantifier_block;
+typedef tuple<int, GateType, vector<int>> gate_definition;
+
 struct Gate {
   string gate_id;
   GateType gate_type;
@@ -32,11 +41,29 @@ struct Gate {
   Gate(string gate_id): gate_id(gate_id), gate_type(GateType::None), variable_depth(0), gate_inputs(nullptr), nr_inputs(0) {}
 };
 
+// Hash for normalized gate inputs (see QBFParser::addNormalizedGate).
+struct GateInputsHash {
+  size_t operator()(const vector<int>& inputs) const {
+    size_t hash = inputs.size();
+    for (auto literal: inputs) {
+      hash ^= std::hash<int>()(literal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+  }
+};
+
 class QBFParser {
 public:
   QBFParser();
   virtual ~QBFParser();
   void setComparator(const string& comparator_filename);
+  void setOrdering(OrderingStrategy strategy);
+  void setStatistics(Statistics* statistics);
+  void keepDefinitionCircuit();
+  void setUniversalExtractor(Extractor* universal_extractor);
+  // Progress reports on standard error (on by default), errors are always reported.
+  void setVerbose(bool verbose);
+  void printParseStatistics();
   void getDefinitions(Extractor& extractor);
   void writeQCIR(const string& filename);
   void writeQCIR();
@@ -46,43 +73,77 @@ public:
   void writeDIMACS();
   void writeVerilog();
   void writeVerilog(const string& filename);
+  void writeAIGER();
+  void writeAIGER(const string& filename);
+  void writeQCIR(std::ostream& out);
+  void writeQDIMACS(std::ostream& out);
+  void writeDIMACS(std::ostream& out);
+  void writeVerilog(std::ostream& out);
+  void writeAIGER(std::ostream& out);
+  void writeQCIR(OutputBuffer& out);
+  void writeQDIMACS(OutputBuffer& out);
+  void writeDIMACS(OutputBuffer& out);
+  void writeVerilog(OutputBuffer& out);
+  void writeAIGER(OutputBuffer& out);
+  unsigned int simplify();
+  // Variables and gates by number: numeric ids are kept, other (symbolic QCIR) ids are numbered after the largest one.
+  vector<int> getDefinedVariables();
+  vector<definition> getDefinitionGates();
 
 protected:
+  vector<int> numericIds();
   virtual void doGetDefinitions(Extractor& extractor);
-  virtual void printQDIMACSPrefix(std::ostream& out);
-  virtual void doWriteQCIR(std::ostream& out);
-  virtual void doWriteVerilog(std::ostream& out);
-  void doWriteQDIMACS(std::ostream& out);
-  void doWriteDIMACS(std::ostream& out);
-  void printClauselist(vector<vector<int>>& clause_list, std::ostream& out);
-  void printQCIRPrefix(std::ostream& out);
-  void printQCIRGate(Gate& gate, std::ostream& out);
-  void printQCIRGates(std::ostream& out);
-  void printAndOrGateVerilog(std::ostream& out, const int alias);
-  template<typename T> void paste(std::ostream& out, vector<T>& arguments, const string& separator);
+  virtual void printQDIMACSPrefix(OutputBuffer& out);
+  virtual void doWriteQCIR(OutputBuffer& out);
+  virtual void doWriteVerilog(OutputBuffer& out);
+  void doWriteQDIMACS(OutputBuffer& out);
+  void doWriteDIMACS(OutputBuffer& out);
+  void doWriteAIGER(OutputBuffer& out);
+  void printQCIRPrefix(OutputBuffer& out);
+  void printQCIRGate(Gate& gate, OutputBuffer& out);
+  void printQCIRGates(OutputBuffer& out);
+  void printGateVerilog(OutputBuffer& out, const int alias);
+  template<typename T> void paste(OutputBuffer& out, vector<T>& arguments, const string& separator);
 
   bool startsWith(const string& line, const string& pattern);
   vector<string> split(const string& s, char delimiter);
 
   void addDefinition(vector<int>& input_literals, int output_alias);
-  vector<vector<int>> getMatrix(bool negate, bool tseitin=false);
-  vector<vector<int>> getDefinitionClauses();
+  ClauseArena getMatrix(bool negate, bool tseitin=false);
+  GatePolarity getOutputPolarity(bool negate, bool tseitin);
+  void addMatrixClauses(bool negate, const vector<GatePolarity>& polarity, ClauseSink& sink);
+  void getDefinitionClauses(ClauseSink& sink);
   int getMaxVariableInt();
   int numberVariables(VariableType type);
   tuple<vector<int>, vector<int>, vector<bool>> getQueryVariableSets(VariableType type);
   void addDefinitions(vector<definition>& definitions, vector<int>& defined_variables);
   auto getDefinitionsFor(Extractor& extractor, VariableType type);
+  void getConcurrentDefinitions(Extractor& extractor, vector<int>& defined_existentials, vector<definition>& definitions_existentials, vector<int>& defined_universals, vector<definition>& definitions_universals);
+  void printNumberDefined(unsigned int nr_defined, VariableType type);
   void addVariable(const string& id, const VariableType type);
   void addGate(const string& id, const GateType& gate_type, const vector<string>& input_literals);
+  void createGate(int alias, const GateType& gate_type, const vector<int>& inputs);
+  void addHashedGate(const string& id, const GateType& gate_type, vector<int>& inputs);
+  void addHashedXorGate(const string& id, const vector<int>& inputs);
+  void addHashedIteGate(const string& id, const vector<int>& inputs);
+  void addNormalizedGate(const string& id, const GateType& gate_type, const vector<int>& inputs, const vector<int>& key, int key_polarity, int value);
+  void endStructuralHashing();
   unsigned int removeRedundant();
+  int constantValue(int literal);
   int getAlias(const string& gate_id);
-  void getGatePolarities(vector<GatePolarity>& polarities, GatePolarity output_polarity);
-  virtual void addToClauseList(int alias, const GatePolarity polarity, vector<vector<int>>& clause_list);
-  virtual void addOutputUnit(bool negate, vector<vector<int>>& clause_list);
+  const vector<GatePolarity>& getGatePolarities(GatePolarity output_polarity);
+  virtual void addToClauseList(int alias, const GatePolarity polarity, ClauseSink& sink);
+  void addXorIteClauses(int alias, const GatePolarity polarity, ClauseSink& sink);
+  virtual void addOutputUnit(bool negate, ClauseSink& sink);
   int sign(const string& literal_string);
   bool isNumber(const string& s);
-  vector<int> gateTopologicalOrdering();
-  bool clausesOK(vector<vector<int>>& clause_list);
+  const vector<int>& gateTopologicalOrdering();
+  const vector<int>& getFanoutCounts();
+  void invalidateGraphCache();
+  vector<long> getOrderingScores(OrderingStrategy strategy);
+  bool isClauseGate(const Gate& gate);
+  static bool isGateType(const GateType& gate_type);
+  bool clausesOK(const ClauseArena& clause_list);
 
   unsigned int max_quantifier_depth;
   int max_alias;
@@ -95,12 +156,33 @@ protected:
   vector<string> defined_ids;
   vector<int> definition_aliases;
   VariableComparator* comparator;
+  OrderingStrategy ordering_strategy;
+  Statistics* statistics;
+  std::unique_ptr<DefinitionCircuit> definition_circuit;
+  // Runs the universal pass concurrently with the existential pass (not used for DQBF).
+  Extractor* universal_extractor;
+  bool verbose;
+  // Gates removed after parsing because they do not feed into the output.
+  unsigned int nr_redundant_gates;
+  // Cached graph metadata, fan-out counts are updated incrementally by addDefinition.
+  vector<int> fanout_counts;
+  vector<int> topological_order;
+  vector<GatePolarity> polarity_cache[4];
+  bool fanout_counts_valid;
+  bool topological_order_valid;
+  // Structural hashing of gates while parsing. Gates that are equal to a literal or to an earlier gate
+  // get no gate of their own, their id is mapped to the (signed) alias instead.
+  bool structural_hashing;
+  unordered_map<vector<int>, int, GateInputsHash> gate_hash;
+  int true_alias;
 
   static const string EXISTS_STRING;
   static const string FORALL_STRING;
   static const string OUTPUT_STRING;
   static const string AND_STRING;
   static const string OR_STRING;
+  static const string XOR_STRING;
+  static const string ITE_STRING;
 
 };
 
@@ -15,12 +15,46 @@ std::string str_tolower(std::string s) {
     return s;
 }
 
-QCIRParser::QCIRParser() {};
+QCIRParser::QCIRParser() {
+  structural_hashing = true;
+}
 
 QCIRParser::QCIRParser(const string& filename) {
+  structural_hashing = true;
   std::ifstream file(filename.c_str());
+  parse(file);
+}
+
+QCIRParser::QCIRParser(std::istream& in) {
+  structural_hashing = true;
+  parse(in);
+}
+
+QCIRParser::QCIRParser(const vector<quantifier_block>& prefix, const vector<gate_definition>& gate_definitions, int output) {
+  structural_hashing = true;
+  // The output gate is never merged, so it has to be known in advance.
+  output_id = std::to_string(output);
+  for (auto& [type, variables]: prefix) {
+    max_quantifier_depth++;
+    for (auto variable: variables) {
+      addVariable(std::to_string(variable), type);
+    }
+  }
+  for (auto& [gate, gate_type, input_literals]: gate_definitions) {
+    vector<string> literal_strings;
+    for (auto literal: input_literals) {
+      literal_strings.push_back(std::to_string(literal));
+    }
+    addGate(std::to_string(gate), gate_type, literal_strings);
+  }
+  endStructuralHashing();
+  assert(id_to_alias.find(output_id) != id_to_alias.end());
+  nr_redundant_gates = removeRedundant();
+}
+
+void QCIRParser::parse(std::istream& in) {
   string line;
-  while (std::getline(file, line)) {
+  while (std::getline(in, line)) {
     line = str_tolower(line);
     line.erase(remove_if(line.begin(), line.end(), [] (char c) { return isspace(int(c)); }), line.end()); // Remove whitespaces.
     if (line.length() == 0 || line.front() == '#') {
@@ -35,10 +69,10 @@ QCIRParser::QCIRParser(const string& filename) {
   }
   assert(output_id.size());
   assert(id_to_alias.find(output_id) != id_to_alias.end());
-  std::cerr << "Done parsing " << gates.size() << " gates." << std::endl;
+  endStructuralHashing();
 
   /* Remove redundant gates (optional). */
-  std::cerr << "Removed " << removeRedundant() << " redundant gates." << std::endl;
+  nr_redundant_gates = removeRedundant();
 }
 
 void QCIRParser::readQuantifierBlock(const string& line) {
@@ -62,10 +96,22 @@ void QCIRParser::readGate(const string& line) {
   assert(opening_pos != string::npos);
   auto gate_type_string = line.substr(equals_pos + 1, opening_pos - equals_pos - 1);
   auto gate_id = line.substr(0, equals_pos);
-  assert(gate_type_string == QBFParser::AND_STRING || gate_type_string == QBFParser::OR_STRING);
-  GateType gate_type = (gate_type_string == QBFParser::AND_STRING) ? GateType::And : GateType::Or;
+  GateType gate_type = GateType::None;
+  if (gate_type_string == QBFParser::AND_STRING) {
+    gate_type = GateType::And;
+  } else if (gate_type_string == QBFParser::OR_STRING) {
+    gate_type = GateType::Or;
+  } else if (gate_type_string == QBFParser::XOR_STRING) {
+    gate_type = GateType::Xor;
+  } else if (gate_type_string == QBFParser::ITE_STRING) {
+    gate_type = GateType::Ite;
+  }
+  assert(gate_type != GateType::None);
   auto gate_inputs_string = line.substr(opening_pos + 1, line.length() - opening_pos - 2);
   auto input_literals = split(gate_inputs_string, ',');
+  // XOR gates are binary, ITE gates have a condition and two branches (QCIR-G14).
+  assert(gate_type != GateType::Xor || input_literals.size() == 2);
+  assert(gate_type != GateType::Ite || input_literals.size() == 3);
   addGate(gate_id, gate_type, input_literals);
 }
 
@@ -11,9 +11,12 @@ using std::string;
 class QCIRParser: virtual public QBFParser {
   public:
     QCIRParser(const string& filename);
+    QCIRParser(std::istream& in);
+    QCIRParser(const vector<quantifier_block>& prefix, const vector<gate_definition>& gate_definitions, int output);
 
   protected:
     QCIRParser();
+    void parse(std::istream& in);
     void readQuantifierBlock(const string& line);
     void readGate(const string& line);
     void readOutput(const string& line);
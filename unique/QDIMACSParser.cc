@@ -15,8 +15,34 @@ QDIMACSParser::QDIMACSParser() {}
 
 QDIMACSParser::QDIMACSParser(const string& filename) {
   std::ifstream file(filename.c_str());
+  parse(file);
+}
+
+QDIMACSParser::QDIMACSParser(std::istream& in) {
+  parse(in);
+}
+
+QDIMACSParser::QDIMACSParser(const vector<quantifier_block>& prefix, const vector<vector<int>>& matrix) {
+  for (auto& [type, variables]: prefix) {
+    max_quantifier_depth++;
+    for (auto variable: variables) {
+      addVariable(std::to_string(variable), type);
+    }
+  }
+  for (auto& clause: matrix) {
+    vector<string> literal_strings;
+    for (auto literal: clause) {
+      literal_strings.push_back(std::to_string(literal));
+    }
+    addGate(std::to_string(max_id_number+1), GateType::Or, literal_strings);
+  }
+  // Add dummy output gate.
+  addOutputGate();
+}
+
+void QDIMACSParser::parse(std::istream& in) {
   string line;
-  while (std::getline(file, line)) {
+  while (std::getline(in, line)) {
     if (line.length() == 0 || line.front() == 'c' || line.front() == 'p') { // Ignore preamble as well.
       continue;
     } else if (startsWith(line, FORALL_STRING) || startsWith(line, EXISTS_STRING)) {
@@ -44,6 +70,7 @@ void QDIMACSParser::addOutputGate() {
   for (unsigned i = 0; i < clause_aliases.size(); i++) {
     output_gate.gate_inputs[i] = clause_aliases[i];
   }
+  invalidateGraphCache();
 }
 
 void QDIMACSParser::readQuantifierBlock(const string& line) {
@@ -68,7 +95,7 @@ void QDIMACSParser::readClause(const string& line) {
   addGate(std::to_string(max_id_number+1), GateType::Or, line_split);
 }
 
-void QDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
+void QDIMACSParser::printQDIMACSPrefix(OutputBuffer& out) {
   GateType last_block_type = GateType::None;
   bool first_variable_seen = false;
   for (unsigned i = 1; i < variable_gate_boundary; i++) {
@@ -77,7 +104,7 @@ void QDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
       if (gate.gate_type != last_block_type) { 
         last_block_type = gate.gate_type;
         if (first_variable_seen) {
-          out << "0" << std::endl; // Close last block unless this is the first variable.
+          out << "0" << '\n'; // Close last block unless this is the first variable.
         }
         auto block_start_string = (gate.gate_type == GateType::Existential) ? 'e' : 'a';
         out << block_start_string << " ";  // "Open" a new quantifier block.
@@ -95,8 +122,12 @@ void QDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
     }
   }
   if (and_gates.size() > 0) {
-    if (last_block_type == GateType::Universal) { // Open new quantifier block if necessary.
-      out << "0" << std::endl << "e ";
+    if (last_block_type != GateType::Existential) { // Open new quantifier block if necessary.
+      if (first_variable_seen) {
+        out << "0" << '\n';
+      }
+      out << "e ";
+      first_variable_seen = true;
     }
     for (auto& alias: and_gates) {
       auto& gate = gates[alias];
@@ -104,22 +135,25 @@ void QDIMACSParser::printQDIMACSPrefix(std::ostream& out) {
     }
   }
   if (first_variable_seen) {  // Close last quantifier block.
-    out << "0" << std::endl;
+    out << "0" << '\n';
   }
 }
 
-void QDIMACSParser::addToClauseList(int alias, const GatePolarity polarity, vector<vector<int>>& clause_list) {
+void QDIMACSParser::addToClauseList(int alias, const GatePolarity polarity, ClauseSink& sink) {
   auto& gate = gates[alias];
-  // Do not introduce auxiliary variables/clauses for input clauses and the output gate.
-  if (gate.gate_type == GateType::Or) {
-    clause_list.emplace_back(vector<int>(gate.gate_inputs, gate.gate_inputs + gate.nr_inputs));
+  // Do not introduce auxiliary variables/clauses for input clauses and the output gate. This only works for the
+  // matrix itself: the negated matrix (universal pass) needs the encoding of both.
+  if (polarity != GatePolarity::Positive && (gate.gate_type == GateType::Or || gate.gate_id == output_id)) {
+    QBFParser::addToClauseList(alias, polarity, sink);
+  } else if (gate.gate_type == GateType::Or) {
+    sink.addClause(gate.gate_inputs, gate.nr_inputs);
   } else if (gate.gate_id != output_id) {
-    QBFParser::addToClauseList(alias, polarity, clause_list);
+    QBFParser::addToClauseList(alias, polarity, sink);
   }
 }
 
-void QDIMACSParser::addOutputUnit(bool negate, vector<vector<int>>& clause_list) {
+void QDIMACSParser::addOutputUnit(bool negate, ClauseSink& sink) {
   if (negate) {
-    clause_list.push_back({-id_to_alias[output_id]});
+    sink.addClause({-id_to_alias[output_id]});
   }
 }
@@ -13,17 +13,20 @@ using std::string;
 class QDIMACSParser: virtual public QBFParser {
   public:
     QDIMACSParser(const string& filename);
+    QDIMACSParser(std::istream& in);
+    QDIMACSParser(const vector<quantifier_block>& prefix, const vector<vector<int>>& matrix);
 
   protected:
     QDIMACSParser();
+    void parse(std::istream& in);
     void readQuantifierBlock(const string& line);
     void readClause(const string& line);
     void addOutputGate();
     vector<string> convertClause(vector<int>& clause);
 
-    virtual void printQDIMACSPrefix(std::ostream& out);
-    virtual void addToClauseList(int alias, const GatePolarity polarity, vector<vector<int>>& clause_list);
-    virtual void addOutputUnit(bool negate, vector<vector<int>>& clause_list);
+    virtual void printQDIMACSPrefix(OutputBuffer& out);
+    virtual void addToClauseList(int alias, const GatePolarity polarity, ClauseSink& sink);
+    virtual void addOutputUnit(bool negate, ClauseSink& sink);
 
     static const string EXISTS_STRING;
     static const string FORALL_STRING;
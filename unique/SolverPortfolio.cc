@@ -0,0 +1,164 @@
+#include "SolverPortfolio.h"
+
+#include <new>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+
+SolverPortfolio::SolverPortfolio(unsigned int nr_solvers, int nr_variables): interrupted(false), race_number(0), nr_running(0), stopping(false), race_conflict_limit(0), winner(-1), result(l_Undef), exceptions(nr_solvers) {
+  for (unsigned int i = 0; i < nr_solvers; i++) {
+    solvers.push_back(std::make_unique<Minisat::Solver>());
+    configure(*solvers.back(), i);
+    // Variable 0 is unused, so that variables need not be shifted.
+    for (int variable = 0; variable <= nr_variables; variable++) {
+      solvers.back()->newVar();
+    }
+  }
+  for (unsigned int i = 1; i < nr_solvers; i++) {
+    workers.emplace_back(&SolverPortfolio::work, this, i);
+  }
+}
+
+SolverPortfolio::~SolverPortfolio() {
+  {
+    std::lock_guard<std::mutex> lock(race_mutex);
+    stopping = true;
+  }
+  race_started.notify_all();
+  for (auto& worker: workers) {
+    worker.join();
+  }
+}
+
+Minisat::Lit SolverPortfolio::miniSatLiteral(int literal) {
+  return Minisat::mkLit(abs(literal), literal < 0);
+}
+
+void SolverPortfolio::configure(Minisat::Solver& solver, unsigned int index) {
+  // The first instance keeps the defaults of MiniSat (Luby restarts, full phase saving, no random decisions).
+  switch (index % 4) {
+    case 1:
+      // Geometric restarts without phase saving.
+      solver.luby_restart = false;
+      solver.restart_inc = 1.5;
+      solver.phase_saving = 0;
+      break;
+    case 2:
+      // Some random decisions with random polarities.
+      solver.random_var_freq = 0.05;
+      solver.rnd_pol = true;
+      break;
+    case 3:
+      // Random initial activities with slower activity decay and basic clause minimization.
+      solver.rnd_init_act = true;
+      solver.var_decay = 0.99;
+      solver.ccmin_mode = 1;
+      solver.phase_saving = 1;
+      break;
+  }
+  // Further instances repeat the configurations with other seeds.
+  solver.random_seed += index;
+}
+
+void SolverPortfolio::addClause(const vector<int>& clause) {
+  Minisat::vec<Minisat::Lit> solver_clause;
+  for (auto& solver: solvers) {
+    solver_clause.clear();
+    for (auto literal: clause) {
+      solver_clause.push(miniSatLiteral(literal));
+    }
+    try {
+      solver->addClause(solver_clause);
+    }
+    catch (Minisat::OutOfMemoryException&) {
+      throw std::bad_alloc();
+    }
+  }
+}
+
+Minisat::lbool SolverPortfolio::race(const vector<int>& assumptions, int conflict_limit) {
+  {
+    std::lock_guard<std::mutex> lock(race_mutex);
+    race_assumptions.clear();
+    for (auto literal: assumptions) {
+      race_assumptions.push(miniSatLiteral(literal));
+    }
+    race_conflict_limit = conflict_limit;
+    winner = -1;
+    result = l_Undef;
+    for (auto& exception: exceptions) {
+      exception = nullptr;
+    }
+    nr_running = workers.size();
+    race_number++;
+  }
+  race_started.notify_all();
+  run(0);
+  {
+    std::unique_lock<std::mutex> lock(race_mutex);
+    race_finished.wait(lock, [this]() { return nr_running == 0; });
+  }
+  // The losers were interrupted by the winner, they are ready for the next race.
+  if (!interrupted) {
+    for (auto& solver: solvers) {
+      solver->clearInterrupt();
+    }
+  }
+  for (auto& exception: exceptions) {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+  return result;
+}
+
+void SolverPortfolio::work(unsigned int index) {
+  // Signals are handled on the main thread, which interrupts the race.
+  sigset_t signals;
+  sigfillset(&signals);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  unsigned long last_race = 0;
+  std::unique_lock<std::mutex> lock(race_mutex);
+  while (true) {
+    race_started.wait(lock, [this, last_race]() { return stopping || race_number != last_race; });
+    if (stopping) {
+      return;
+    }
+    last_race = race_number;
+    lock.unlock();
+    run(index);
+    lock.lock();
+    if (--nr_running == 0) {
+      race_finished.notify_one();
+    }
+  }
+}
+
+void SolverPortfolio::run(unsigned int index) {
+  try {
+    solvers[index]->setConfBudget(race_conflict_limit);
+    auto solver_result = solvers[index]->solveLimited(race_assumptions);
+    int no_winner = -1;
+    if (solver_result != l_Undef && winner.compare_exchange_strong(no_winner, index)) {
+      result = solver_result;
+      for (unsigned int j = 0; j < solvers.size(); j++) {
+        if (j != index) {
+          solvers[j]->interrupt();
+        }
+      }
+    }
+  }
+  catch (Minisat::OutOfMemoryException&) {
+    exceptions[index] = std::make_exception_ptr(std::bad_alloc());
+  }
+  catch (...) {
+    exceptions[index] = std::current_exception();
+  }
+}
+
+void SolverPortfolio::interrupt() {
+  interrupted = true;
+  for (auto& solver: solvers) {
+    solver->interrupt();
+  }
+}
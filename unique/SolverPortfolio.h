@@ -0,0 +1,57 @@
+#ifndef SolverPortfolio_h
+#define SolverPortfolio_h
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "minisat/core/Solver.h"
+
+using std::vector;
+using std::unique_ptr;
+
+/*
+  Differently configured MiniSat instances (restart policy, phase saving, random decisions, seed) on the
+  same clauses. A query is raced on one thread per instance, the first instance that decides it wins and
+  the others are interrupted. The first instance runs on the calling thread, the others on worker threads
+  that are started with the portfolio and wait for the next race. The instances do not compute interpolants,
+  they only decide satisfiability. Literals are signed integers (as in DIMACS).
+*/
+class SolverPortfolio {
+public:
+  SolverPortfolio(unsigned int nr_solvers, int nr_variables);
+  ~SolverPortfolio();
+  void addClause(const vector<int>& clause);
+  // Returns l_Undef if no instance decided within the conflict limit (or if interrupted).
+  Minisat::lbool race(const vector<int>& assumptions, int conflict_limit);
+  void interrupt();
+
+protected:
+  static Minisat::Lit miniSatLiteral(int literal);
+  static void configure(Minisat::Solver& solver, unsigned int index);
+  void work(unsigned int index);
+  void run(unsigned int index);
+
+  vector<unique_ptr<Minisat::Solver>> solvers;
+  // Set by interrupt(), so that interrupts from outside are not cleared after a race.
+  std::atomic<bool> interrupted;
+  // The current race, written by race() under race_mutex before the workers are woken up.
+  vector<std::thread> workers;
+  std::mutex race_mutex;
+  std::condition_variable race_started;
+  std::condition_variable race_finished;
+  unsigned long race_number;
+  unsigned int nr_running;
+  bool stopping;
+  Minisat::vec<Minisat::Lit> race_assumptions;
+  int race_conflict_limit;
+  std::atomic<int> winner;
+  Minisat::lbool result;
+  vector<std::exception_ptr> exceptions;
+};
+
+#endif
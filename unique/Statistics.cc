@@ -0,0 +1,180 @@
+#include "Statistics.h"
+
+#include <fstream>
+#include <iostream>
+#include <assert.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+Statistics::Statistics(): start_time(std::chrono::steady_clock::now()), named_variables(0) {}
+
+double Statistics::now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+long Statistics::peakMemory() {
+  // Peak resident set size in kilobytes.
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+long Statistics::residentMemory() {
+  // Current resident set size in kilobytes, falls back to the peak where /proc is not available.
+  std::ifstream statm("/proc/self/statm");
+  long total_pages, resident_pages;
+  if (statm >> total_pages >> resident_pages) {
+    return resident_pages * (sysconf(_SC_PAGESIZE) / 1024);
+  }
+  return peakMemory();
+}
+
+void Statistics::startPhase(const string& name) {
+  open_phases.push_back(phases.size());
+  phases.push_back({name, now(), 0.0, 0, residentMemory(), 0, 0});
+}
+
+void Statistics::endPhase() {
+  assert(!open_phases.empty());
+  auto& phase = phases[open_phases.back()];
+  open_phases.pop_back();
+  phase.duration = now() - phase.start;
+  phase.peak_memory = peakMemory();
+  phase.memory_delta = residentMemory() - phase.start_memory;
+}
+
+void Statistics::startVariable(int alias) {
+  variables.push_back({alias, "", now(), 0.0, false, 0, 0});
+}
+
+void Statistics::endVariable(bool defined) {
+  assert(!variables.empty());
+  auto& record = variables.back();
+  record.duration = now() - record.start;
+  record.defined = defined;
+}
+
+void Statistics::setDefinitionSize(int alias, int size) {
+  // Definitions are extracted after all queries of a run, so look for the latest record.
+  for (auto it = variables.rbegin(); it != variables.rend(); it++) {
+    if (it->alias == alias) {
+      it->definition_size = size;
+      return;
+    }
+  }
+}
+
+void Statistics::nameVariables(const std::function<string(int)>& alias_to_id) {
+  for (; named_variables < variables.size(); named_variables++) {
+    auto& record = variables[named_variables];
+    record.variable_id = alias_to_id(record.alias);
+  }
+}
+
+void Statistics::merge(const Statistics& other) {
+  // Adds the records of statistics collected concurrently (on another thread), they get the next track of the trace.
+  double offset = std::chrono::duration<double>(other.start_time - start_time).count();
+  for (auto phase: other.phases) {
+    phase.start += offset;
+    phase.track++;
+    phases.push_back(phase);
+  }
+  for (auto record: other.variables) {
+    record.start += offset;
+    record.track++;
+    variables.push_back(record);
+  }
+}
+
+void Statistics::writeJSON(const string& filename) {
+  std::ofstream out(filename);
+  if (out) {
+    doWriteJSON(out);
+  } else {
+    std::cerr << "Error opening file: " << filename << std::endl;
+  }
+}
+
+void Statistics::writeTrace(const string& filename) {
+  std::ofstream out(filename);
+  if (out) {
+    doWriteTrace(out);
+  } else {
+    std::cerr << "Error opening file: " << filename << std::endl;
+  }
+}
+
+void Statistics::printString(std::ostream& out, const string& s) {
+  out << '"';
+  for (char c: s) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+void Statistics::doWriteJSON(std::ostream& out) {
+  out << "{" << std::endl;
+  out << "  \"wall_time\": " << now() << "," << std::endl;
+  out << "  \"peak_memory_kb\": " << peakMemory() << "," << std::endl;
+  out << "  \"phases\": [";
+  for (unsigned i = 0; i < phases.size(); i++) {
+    auto& phase = phases[i];
+    out << (i ? "," : "") << std::endl << "    {\"name\": ";
+    printString(out, phase.name);
+    out << ", \"start\": " << phase.start << ", \"time\": " << phase.duration << ", \"peak_memory_kb\": " << phase.peak_memory << ", \"memory_delta_kb\": " << phase.memory_delta << "}";
+  }
+  out << std::endl << "  ]," << std::endl;
+  out << "  \"variables\": [";
+  for (unsigned i = 0; i < variables.size(); i++) {
+    auto& record = variables[i];
+    out << (i ? "," : "") << std::endl << "    {\"id\": ";
+    printString(out, record.variable_id);
+    out << ", \"time\": " << record.duration << ", \"result\": " << (record.defined ? "\"defined\"" : "\"undefined\"") << ", \"definition_size\": " << record.definition_size << "}";
+  }
+  out << std::endl << "  ]" << std::endl;
+  out << "}" << std::endl;
+}
+
+void Statistics::doWriteTrace(std::ostream& out) {
+  // Chrome trace event format (timestamps in microseconds), phases on thread 1 and queries on thread 2. Merged
+  // statistics are on threads 3 and 4, and so on.
+  out << "{\"traceEvents\": [";
+  bool first = true;
+  for (auto& phase: phases) {
+    out << (first ? "" : ",") << std::endl << "  {\"name\": ";
+    printString(out, phase.name);
+    out << ", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << 2 * phase.track + 1 << ", \"ts\": " << long(phase.start * 1e6) << ", \"dur\": " << long(phase.duration * 1e6) << "}";
+    first = false;
+  }
+  for (auto& record: variables) {
+    out << (first ? "" : ",") << std::endl << "  {\"name\": ";
+    printString(out, record.variable_id);
+    out << ", \"cat\": \"query\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << 2 * record.track + 2 << ", \"ts\": " << long(record.start * 1e6) << ", \"dur\": " << long(record.duration * 1e6);
+    out << ", \"args\": {\"result\": " << (record.defined ? "\"defined\"" : "\"undefined\"") << ", \"definition_size\": " << record.definition_size << "}}";
+    first = false;
+  }
+  out << std::endl << "]}" << std::endl;
+}
+
+PhaseTimer::PhaseTimer(Statistics* statistics, const string& name): statistics(statistics) {
+  if (statistics) {
+    statistics->startPhase(name);
+  }
+}
+
+PhaseTimer::~PhaseTimer() {
+  stop();
+}
+
+void PhaseTimer::stop() {
+  if (statistics) {
+    statistics->endPhase();
+    statistics = nullptr;
+  }
+}
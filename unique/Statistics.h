@@ -0,0 +1,73 @@
+#ifndef Statistics_h
+#define Statistics_h
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+struct PhaseRecord {
+  string name;
+  double start;
+  double duration;
+  // Peak resident set size of the process at the end of the phase, and growth of the resident set during it.
+  long peak_memory;
+  long start_memory;
+  long memory_delta;
+  unsigned track;
+};
+
+struct VariableRecord {
+  int alias;
+  string variable_id;
+  double start;
+  double duration;
+  bool defined;
+  int definition_size;
+  unsigned track;
+};
+
+class Statistics {
+public:
+  Statistics();
+  void startPhase(const string& name);
+  void endPhase();
+  void startVariable(int alias);
+  void endVariable(bool defined);
+  void setDefinitionSize(int alias, int size);
+  void nameVariables(const std::function<string(int)>& alias_to_id);
+  void merge(const Statistics& other);
+  void writeJSON(const string& filename);
+  void writeTrace(const string& filename);
+  static long peakMemory();
+  static long residentMemory();
+  static void printString(std::ostream& out, const string& s);
+
+protected:
+  double now();
+  void doWriteJSON(std::ostream& out);
+  void doWriteTrace(std::ostream& out);
+
+  std::chrono::steady_clock::time_point start_time;
+  vector<PhaseRecord> phases;
+  vector<unsigned> open_phases;
+  vector<VariableRecord> variables;
+  unsigned named_variables;
+};
+
+// Times a phase for the lifetime of the object (does nothing without statistics).
+class PhaseTimer {
+public:
+  PhaseTimer(Statistics* statistics, const string& name);
+  ~PhaseTimer();
+  void stop();
+
+protected:
+  Statistics* statistics;
+};
+
+#endif
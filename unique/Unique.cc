@@ -0,0 +1,36 @@
+#include "Unique.h"
+
+#include "QCIRParser.h"
+#include "QDIMACSParser.h"
+
+ExtractionResult extractDefinitions(QBFParser& parser, const ExtractionOptions& options) {
+  Extractor extractor(options.conflict_limit, options.definition_mode);
+  extractor.setPreprocessing(options.preprocess);
+  extractor.setRenumbering(options.renumber);
+  extractor.setVerbose(options.verbose);
+  parser.setVerbose(options.verbose);
+  parser.getDefinitions(extractor);
+  return {parser.getDefinedVariables(), parser.getDefinitionGates()};
+}
+
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<vector<int>>& matrix, const ExtractionOptions& options) {
+  QDIMACSParser parser(prefix, matrix);
+  return extractDefinitions(parser, options);
+}
+
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<gate_definition>& gate_definitions, int output, const ExtractionOptions& options) {
+  QCIRParser parser(prefix, gate_definitions, output);
+  return extractDefinitions(parser, options);
+}
+
+ExtractionResult extractDefinitions(QBFParser& parser, int conflict_limit, mode definition_mode) {
+  return extractDefinitions(parser, ExtractionOptions{ conflict_limit, definition_mode });
+}
+
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<vector<int>>& matrix, int conflict_limit, mode definition_mode) {
+  return extractDefinitions(prefix, matrix, ExtractionOptions{ conflict_limit, definition_mode });
+}
+
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<gate_definition>& gate_definitions, int output, int conflict_limit, mode definition_mode) {
+  return extractDefinitions(prefix, gate_definitions, output, ExtractionOptions{ conflict_limit, definition_mode });
+}
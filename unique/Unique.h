@@ -0,0 +1,45 @@
+#ifndef Unique_h
+#define Unique_h
+
+#include <vector>
+#include <tuple>
+
+#include "extractor.h"
+#include "QBFParser.h"
+
+using std::vector;
+using std::tuple;
+
+/*
+  Library interface for running the extractor on instances held in memory. Variables and
+  gates are identified by positive integers and literals are signed integers (as in QDIMACS).
+  Definitions are AND gates given as (input literals, output) in topological order, where
+  outputs are either defined variables or fresh auxiliary variables.
+*/
+
+struct ExtractionResult {
+  vector<int> defined;
+  vector<definition> definitions;
+};
+
+/*
+  Extraction is quiet unless verbose is set, in which case progress is reported on standard error
+  (as by the command line tool). Preprocessing and renumbering are the --preprocess and --renumber options.
+*/
+struct ExtractionOptions {
+  int conflict_limit = 1000;
+  mode definition_mode = mode::both;
+  bool preprocess = false;
+  bool renumber = false;
+  bool verbose = false;
+};
+
+ExtractionResult extractDefinitions(QBFParser& parser, const ExtractionOptions& options);
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<vector<int>>& matrix, const ExtractionOptions& options);
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<gate_definition>& gate_definitions, int output, const ExtractionOptions& options);
+
+ExtractionResult extractDefinitions(QBFParser& parser, int conflict_limit = 1000, mode definition_mode = mode::both);
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<vector<int>>& matrix, int conflict_limit = 1000, mode definition_mode = mode::both);
+ExtractionResult extractDefinitions(const vector<quantifier_block>& prefix, const vector<gate_definition>& gate_definitions, int output, int conflict_limit = 1000, mode definition_mode = mode::both);
+
+#endif
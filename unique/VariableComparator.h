@@ -4,6 +4,9 @@
 #include <string>
 #include <unordered_map>
 #include <tuple>
+#include <vector>
+
+enum class OrderingStrategy { Input, Occurrence, Cone, Depth, Gates };
 
 class VariableComparator {
 public:
@@ -30,4 +33,23 @@ protected:
   std::unordered_map<std::string, int> ordering_index;
 };
 
+class ScoreComparator {
+public:
+  ScoreComparator(const std::vector<long>& scores): scores(scores) {}
+
+  bool operator ()(const std::tuple<int,std::string,bool>& first_tuple, const std::tuple<int,std::string,bool>& second_tuple) const {
+    const auto& x = std::get<0>(first_tuple);
+    const auto& y = std::get<0>(second_tuple);
+    if (scores[x] != scores[y]) {
+      // Variables with higher scores are checked first.
+      return scores[x] > scores[y];
+    } else {
+      // Break ties according to alias.
+      return x < y;
+    }
+  };
+protected:
+  std::vector<long> scores;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "extractor.h"
+#include "QBFParser.h"
+#include "QCIRParser.h"
+#include "QDIMACSParser.h"
+
+using std::string;
+using std::vector;
+
+/* Exposes the protected parts of a parser to the benchmarks. */
+template<typename Parser> class BenchmarkParser: public Parser {
+public:
+  BenchmarkParser(const string& filename): Parser(filename) {}
+  using QBFParser::getMatrix;
+  using QBFParser::getMaxVariableInt;
+  using QBFParser::getGatePolarities;
+  using QBFParser::gateTopologicalOrdering;
+  using QBFParser::invalidateGraphCache;
+  using QBFParser::doWriteQCIR;
+  using QBFParser::doWriteQDIMACS;
+  using QBFParser::doWriteDIMACS;
+  using QBFParser::doWriteVerilog;
+
+  // Define every existential variable as the conjunction of two universal variables (as the extractor would).
+  void addSyntheticDefinitions() {
+    vector<int> universals, defined;
+    vector<tuple<vector<int>,int>> definitions;
+    for (int alias = 1; alias < this->variable_gate_boundary; alias++) {
+      if (this->gates[alias].gate_type == GateType::Universal) {
+        universals.push_back(alias);
+      }
+    }
+    int next_alias = this->gates.size();
+    for (int alias = 1; alias < this->variable_gate_boundary && universals.size() > 1; alias++) {
+      if (this->gates[alias].gate_type == GateType::Existential) {
+        vector<int> inputs = {universals[alias % universals.size()], -universals[(alias + 1) % universals.size()]};
+        definitions.push_back(std::make_tuple(inputs, next_alias));
+        definitions.push_back(std::make_tuple(vector<int>{next_alias++}, alias));
+        defined.push_back(alias);
+      }
+    }
+    this->addDefinitions(definitions, defined);
+  }
+};
+
+class BenchmarkExtractor: public Extractor {
+public:
+  BenchmarkExtractor(): Extractor(0, mode::both) {}
+  using Extractor::localityOrder;
+  using Extractor::definitionsFromCircuit;
+};
+
+/* Random instances with a universal block followed by an existential block. */
+class InstanceFile {
+public:
+  InstanceFile(const string& contents) {
+    char filename_template[] = "/tmp/unique_benchXXXXXX";
+    int fd = mkstemp(filename_template);
+    close(fd);
+    filename = filename_template;
+    std::ofstream out(filename);
+    out << contents;
+  }
+  ~InstanceFile() {
+    unlink(filename.c_str());
+  }
+  string filename;
+};
+
+static string randomQDIMACS(int nr_variables) {
+  std::mt19937 generator(nr_variables);
+  std::uniform_int_distribution<int> variable(1, nr_variables);
+  int nr_clauses = 4 * nr_variables;
+  string contents = "p cnf " + std::to_string(nr_variables) + " " + std::to_string(nr_clauses) + "\na ";
+  for (int v = 1; v <= nr_variables; v++) {
+    contents += std::to_string(v) + " ";
+    if (v == nr_variables / 2) {
+      contents += "0\ne ";
+    }
+  }
+  contents += "0\n";
+  for (int c = 0; c < nr_clauses; c++) {
+    for (int l = 0; l < 3; l++) {
+      contents += (generator() % 2 ? "-" : "") + std::to_string(variable(generator)) + " ";
+    }
+    contents += "0\n";
+  }
+  return contents;
+}
+
+static string randomQCIR(int nr_variables) {
+  std::mt19937 generator(nr_variables);
+  int nr_gates = 4 * nr_variables;
+  string contents = "#QCIR-G14\nforall(";
+  for (int v = 1; v <= nr_variables; v++) {
+    contents += std::to_string(v);
+    contents += (v == nr_variables / 2) ? ")\nexists(" : (v < nr_variables ? "," : ")\n");
+  }
+  contents += "output(" + std::to_string(nr_variables + nr_gates) + ")\n";
+  for (int g = nr_variables + 1; g <= nr_variables + nr_gates; g++) {
+    // Gates use variables and previously defined gates as inputs.
+    std::uniform_int_distribution<int> input(1, g - 1);
+    contents += std::to_string(g) + (g % 2 ? " = and(" : " = or(");
+    for (int l = 0; l < 3; l++) {
+      contents += (l ? ", " : "") + string(generator() % 2 ? "-" : "") + std::to_string(input(generator));
+    }
+    contents += ")\n";
+  }
+  return contents;
+}
+
+static void BM_ParseQDIMACS(benchmark::State& state) {
+  auto contents = randomQDIMACS(state.range(0));
+  InstanceFile file(contents);
+  for (auto _: state) {
+    QDIMACSParser parser(file.filename);
+  }
+  state.SetBytesProcessed(state.iterations() * contents.size());
+}
+BENCHMARK(BM_ParseQDIMACS)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_ParseQCIR(benchmark::State& state) {
+  auto contents = randomQCIR(state.range(0));
+  InstanceFile file(contents);
+  for (auto _: state) {
+    QCIRParser parser(file.filename);
+  }
+  state.SetBytesProcessed(state.iterations() * contents.size());
+}
+BENCHMARK(BM_ParseQCIR)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_GetMatrix(benchmark::State& state) {
+  InstanceFile file(randomQCIR(state.range(0)));
+  BenchmarkParser<QCIRParser> parser(file.filename);
+  for (auto _: state) {
+    auto matrix = parser.getMatrix(false);
+    benchmark::DoNotOptimize(matrix);
+  }
+}
+BENCHMARK(BM_GetMatrix)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_GatePolarities(benchmark::State& state) {
+  InstanceFile file(randomQCIR(state.range(0)));
+  BenchmarkParser<QCIRParser> parser(file.filename);
+  for (auto _: state) {
+    // Measure the computation, not the cache.
+    parser.invalidateGraphCache();
+    auto& polarities = parser.getGatePolarities(GatePolarity::Positive);
+    benchmark::DoNotOptimize(polarities);
+  }
+}
+BENCHMARK(BM_GatePolarities)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_GateTopologicalOrdering(benchmark::State& state) {
+  InstanceFile file(randomQCIR(state.range(0)));
+  BenchmarkParser<QCIRParser> parser(file.filename);
+  for (auto _: state) {
+    parser.invalidateGraphCache();
+    auto& ordering = parser.gateTopologicalOrdering();
+    benchmark::DoNotOptimize(ordering);
+  }
+}
+BENCHMARK(BM_GateTopologicalOrdering)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_LocalityOrder(benchmark::State& state) {
+  int nr_variables = state.range(0);
+  InstanceFile file(randomQDIMACS(nr_variables));
+  BenchmarkParser<QDIMACSParser> parser(file.filename);
+  auto matrix = parser.getMatrix(false);
+  int max_variable_int = parser.getMaxVariableInt();
+  BenchmarkExtractor extractor;
+  for (auto _: state) {
+    auto order = extractor.localityOrder(matrix, max_variable_int);
+    benchmark::DoNotOptimize(order);
+  }
+  state.SetItemsProcessed(state.iterations() * matrix.size());
+}
+BENCHMARK(BM_LocalityOrder)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_DefinitionsFromCircuit(benchmark::State& state) {
+  int nr_nodes = state.range(0);
+  std::mt19937 generator(nr_nodes);
+  int nr_inputs = 64, nr_outputs = 64;
+  Aig_Man_t* circuit = Aig_ManStart(nr_nodes);
+  vector<Aig_Obj_t*> nodes;
+  vector<int> input_variables, defined;
+  for (int i = 0; i < nr_inputs; i++) {
+    nodes.push_back(Aig_ObjCreateCi(circuit));
+    input_variables.push_back(i + 1);
+  }
+  for (int i = 0; i < nr_nodes; i++) {
+    auto first = Aig_NotCond(nodes[generator() % nodes.size()], generator() % 2);
+    auto second = Aig_NotCond(nodes[generator() % nodes.size()], generator() % 2);
+    nodes.push_back(Aig_And(circuit, first, second));
+  }
+  for (int i = 0; i < nr_outputs; i++) {
+    Aig_ObjCreateCo(circuit, nodes[nodes.size() - 1 - i]);
+    defined.push_back(nr_inputs + i + 1);
+  }
+  BenchmarkExtractor extractor;
+  for (auto _: state) {
+    auto definitions = extractor.definitionsFromCircuit(circuit, defined, input_variables);
+    benchmark::DoNotOptimize(definitions);
+  }
+  Aig_ManStop(circuit);
+}
+BENCHMARK(BM_DefinitionsFromCircuit)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_WriteQCIR(benchmark::State& state) {
+  InstanceFile file(randomQCIR(state.range(0)));
+  BenchmarkParser<QCIRParser> parser(file.filename);
+  parser.addSyntheticDefinitions();
+  OutputBuffer out("/dev/null");
+  for (auto _: state) {
+    parser.doWriteQCIR(out);
+  }
+}
+BENCHMARK(BM_WriteQCIR)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_WriteQDIMACS(benchmark::State& state) {
+  InstanceFile file(randomQDIMACS(state.range(0)));
+  BenchmarkParser<QDIMACSParser> parser(file.filename);
+  parser.addSyntheticDefinitions();
+  OutputBuffer out("/dev/null");
+  for (auto _: state) {
+    parser.doWriteQDIMACS(out);
+  }
+}
+BENCHMARK(BM_WriteQDIMACS)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_WriteDIMACS(benchmark::State& state) {
+  InstanceFile file(randomQDIMACS(state.range(0)));
+  BenchmarkParser<QDIMACSParser> parser(file.filename);
+  parser.addSyntheticDefinitions();
+  OutputBuffer out("/dev/null");
+  for (auto _: state) {
+    parser.doWriteDIMACS(out);
+  }
+}
+BENCHMARK(BM_WriteDIMACS)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+static void BM_WriteVerilog(benchmark::State& state) {
+  InstanceFile file(randomQDIMACS(state.range(0)));
+  BenchmarkParser<QDIMACSParser> parser(file.filename);
+  parser.addSyntheticDefinitions();
+  OutputBuffer out("/dev/null");
+  for (auto _: state) {
+    parser.doWriteVerilog(out);
+  }
+}
+BENCHMARK(BM_WriteVerilog)->RangeMultiplier(4)->Range(1 << 8, 1 << 16);
+
+BENCHMARK_MAIN();
@@ -1,10 +1,19 @@
 #include <signal.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iterator>
 #include <tuple>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include <docopt.h>
 #include <docopt_util.h>
@@ -15,40 +24,144 @@
 #include "DQCIRParser.h"
 #include "QDIMACSParser.h"
 #include "DQDIMACSParser.h"
+#include "Statistics.h"
+#include "BatchRunner.h"
+#include "JobServer.h"
 
 using std::string;
 
 static const char USAGE[] =
 R"(Usage: 
   unique [options] <input file>
+  unique [options] --batch <path>
+  unique [options] --daemon <socket>
 
 Options:
   -h --help                     shows this screen
   -c --conflict-limit <int>     conflict limit for SAT solver (per variable) [default: 1000]
   -o --output-file <filename>   writes output to the given file (instead of standard output)
+  --mmap-output                 write the output file through a memory mapping
   -m --mode <mode>              determines which variables may be used in definitions [default: both]
                                 (both | other-defined | other)
   --output-format <format>      Output format [default: QCIR]
-                                (QCIR | QDIMACS | DIMACS | Verilog)
+                                (QCIR | QDIMACS | DIMACS | Verilog | AIGER)
+  --backend <backend>           interpolation backend used for definability queries [default: minisat]
+                                (minisat)
+  --minimize                    minimize definitions using the matrix as a care set
+  --preprocess                  preprocess the matrix (subsumption, variable elimination) before extraction
+  --renumber                    renumber variables in the solver for locality (instead of the input order)
+  --cache <filename>            reuse definability results of earlier runs stored in this file (and add new ones)
+  --concurrent-passes           run the existential and universal passes concurrently (on two threads)
+  --portfolio <int>             race variables that exceed the conflict limit on this many differently
+                                configured solvers (on as many threads, 0 = disabled), results may
+                                differ between runs [default: 0]
+  --no-simplify                 do not simplify QCIR/QDIMACS output after substituting definitions
+  --rounds <int>                maximum number of query rounds, each round queries the variables that
+                                reached the conflict limit again with twice the limit
+                                (no effect with --conflict-limit 0) [default: 1]
+  --memory-limit <MB>           stop extraction and keep the definitions found so far before the resident
+                                memory exceeds this limit (0 = unlimited) [default: 0]
   --ordering-file <filename>    Read variable ordering for definability from file.               
+  --ordering <strategy>         Heuristic variable ordering for definability [default: input]
+                                (input | occurrence | cone | depth | gates), all but input are
+                                experimental and have not been benchmarked
+  --stats-json <filename>       Write per-variable and per-phase statistics (JSON) to file.
+  --trace-file <filename>       Write a timeline in Chrome trace event format to file.
+  --batch <path>                Process all instances in a directory or listed in a file (one per line).
+  -j --jobs <int>               Number of worker processes in batch mode [default: 1]
+  --time-limit <seconds>        CPU time limit per instance in batch mode (0 = unlimited) [default: 0]
+  --instance-memory-limit <MB>  Address space limit per instance in batch mode (0 = unlimited) [default: 0]
+  --output-dir <directory>      Directory for outputs, statistics, and logs in batch mode [default: .]
+  --daemon <socket>             Serve jobs on a Unix domain socket.
 )";
 
+// The signal handler only sets the flag and wakes the signal watcher through a pipe, the watcher thread interrupts the
+// running extractors. They are registered under the mutex, so they are not destroyed while the watcher uses them.
 static volatile sig_atomic_t sig_caught = 0;
-static unique_ptr<Extractor> extractor = nullptr;
+static volatile sig_atomic_t signal_pipe_input = -1;
+static std::mutex running_extractors_mutex;
+static vector<Extractor*> running_extractors;
 
 void handle_sighup(int signum) 
 {
-  std::cerr << "Received signal " << signum << ", trying to shut down gracefully." << std::endl;
+  int saved_errno = errno;
   sig_caught = 1;
-  if (extractor) {
-    extractor->interrupt();
+  int input = signal_pipe_input;
+  if (input >= 0) {
+    // If the pipe is full, the watcher has not yet read earlier signals and will interrupt the extractors anyway.
+    unsigned char byte = signum;
+    [[maybe_unused]] auto written = write(input, &byte, 1);
+  }
+  errno = saved_errno;
+}
+
+/*
+  Thread that interrupts the running extractors when a signal is caught, for the duration of an extraction. All other
+  threads block signals, so the handler runs on the thread that creates and destroys the watcher.
+*/
+class SignalWatcher {
+public:
+  SignalWatcher() {
+    if (pipe(pipe_fds) != 0) {
+      std::cerr << "Could not create signal pipe, signals will not interrupt the extraction." << std::endl;
+      return;
+    }
+    fcntl(pipe_fds[1], F_SETFL, O_NONBLOCK);
+    // The thread inherits the blocked signals.
+    sigset_t signals, previous_signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous_signals);
+    watcher = std::thread(&SignalWatcher::watch, this);
+    pthread_sigmask(SIG_SETMASK, &previous_signals, nullptr);
+    signal_pipe_input = pipe_fds[1];
+  }
+  ~SignalWatcher() {
+    if (!watcher.joinable()) {
+      return;
+    }
+    signal_pipe_input = -1;
+    // Signal 0 stops the watcher, the write only fails while the watcher still has to empty the pipe.
+    unsigned char stop = 0;
+    while (write(pipe_fds[1], &stop, 1) != 1) {
+      std::this_thread::yield();
+    }
+    watcher.join();
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+  }
+  SignalWatcher(const SignalWatcher&) = delete;
+  SignalWatcher& operator=(const SignalWatcher&) = delete;
+
+protected:
+  void watch() {
+    unsigned char signum;
+    while (read(pipe_fds[0], &signum, 1) == 1 && signum != 0) {
+      std::lock_guard<std::mutex> lock(running_extractors_mutex);
+      std::cerr << "Received signal " << int(signum) << ", trying to shut down gracefully." << std::endl;
+      for (auto extractor: running_extractors) {
+        extractor->interrupt();
+      }
+    }
+  }
+
+  int pipe_fds[2];
+  std::thread watcher;
+};
+
+void setRunningExtractors(const vector<Extractor*>& extractors) {
+  std::lock_guard<std::mutex> lock(running_extractors_mutex);
+  running_extractors = extractors;
+  // A signal caught before the extractors were registered.
+  if (sig_caught) {
+    for (auto extractor: running_extractors) {
+      extractor->interrupt();
+    }
   }
 }
 
 enum class filetype: int { None, QDIMACS, DQDIMACS, QCIR, DQCIR };
 
-filetype checkFileType(const string& filename) {
-  auto file = std::ifstream(filename);
+filetype checkFileType(std::istream& file) {
   if (file.good()) {
     string first_line;
     std::getline(file, first_line);
@@ -78,38 +191,69 @@ filetype checkFileType(const string& filename) {
   return filetype::None;
 }
 
-int main(int argc, char* argv[]) {
-  std::map<std::string, docopt::value> args = docopt::docopt(USAGE, { argv + 1, argv + argc }, true, "Unique v.0.1");
+filetype checkFileType(const string& filename) {
+  auto file = std::ifstream(filename);
+  return checkFileType(file);
+}
 
+unique_ptr<QBFParser> makeParser(filetype input_filetype, std::istream& in, const string& input_name) {
   unique_ptr<QBFParser> parser;
-  string input_filename = args["<input file>"].asString();
-
-  filetype input_filetype = checkFileType(input_filename);
-
   switch(input_filetype) {
     case filetype::QDIMACS:
-      parser = std::make_unique<QDIMACSParser>(input_filename);
-      std::cerr << "Reading QDIMACS file: " << input_filename << std::endl;
-      break;
+      std::cerr << "Reading QDIMACS file: " << input_name << std::endl;
+      return std::make_unique<QDIMACSParser>(in);
     case filetype::QCIR:
-      parser = std::make_unique<QCIRParser>(input_filename);
-      std::cerr << "Reading QCIR file: " << input_filename << std::endl;
+      std::cerr << "Reading QCIR file: " << input_name << std::endl;
+      parser = std::make_unique<QCIRParser>(in);
       break;
     case filetype::DQCIR:
-      parser = std::make_unique<DQCIRParser>(input_filename);
+      parser = std::make_unique<DQCIRParser>(in);
       break;
     case filetype::DQDIMACS:
-      parser = std::make_unique<DQDIMACSParser>(input_filename);
-      std::cerr << "Reading DQDIMACS file: " << input_filename << std::endl;
-      break;
-    case filetype::None:
-      std::cerr << "Invalid input file: " << input_filename << std::endl;
-      return 1;
+      std::cerr << "Reading DQDIMACS file: " << input_name << std::endl;
+      return std::make_unique<DQDIMACSParser>(in);
+    default:
+      std::cerr << "Invalid input file: " << input_name << std::endl;
+      return nullptr;
   }
+  // Only circuits have redundant gates, which are removed after parsing.
+  parser->printParseStatistics();
+  return parser;
+}
+
+bool simplifyOutput(std::map<std::string, docopt::value>& args) {
+  return (args["--output-format"].asString() == "QCIR" || args["--output-format"].asString() == "QDIMACS") && !args["--no-simplify"].asBool();
+}
+
+unique_ptr<Extractor> makeExtractor(std::map<std::string, docopt::value>& args, mode definition_mode, DefinabilityCache* cache) {
+  auto extractor = std::make_unique<Extractor>(args["--conflict-limit"].asLong(), definition_mode);
+  extractor->setBackend(BackendType::MiniSat);
+  extractor->setMemoryLimit(args["--memory-limit"].asLong());
+  extractor->setMinimizeDefinitions(args["--minimize"].asBool());
+  extractor->setPreprocessing(args["--preprocess"].asBool());
+  extractor->setRenumbering(args["--renumber"].asBool());
+  extractor->setCache(cache);
+  extractor->setPortfolio(std::max(0L, args["--portfolio"].asLong()));
+  extractor->setRounds(std::max(1L, args["--rounds"].asLong()));
+  return extractor;
+}
+
+void extractDefinitions(std::map<std::string, docopt::value>& args, QBFParser& parser, Statistics* statistics) {
+  parser.setStatistics(statistics);
 
   if (args["--ordering-file"]) {
     std::cerr << "Using ordering file: " << args["--ordering-file"].asString() << std::endl;
-    parser->setComparator(args["--ordering-file"].asString());
+    parser.setComparator(args["--ordering-file"].asString());
+  } else if (args["--ordering"].asString() == "occurrence") {
+    parser.setOrdering(OrderingStrategy::Occurrence);
+  } else if (args["--ordering"].asString() == "cone") {
+    parser.setOrdering(OrderingStrategy::Cone);
+  } else if (args["--ordering"].asString() == "depth") {
+    parser.setOrdering(OrderingStrategy::Depth);
+  } else if (args["--ordering"].asString() == "gates") {
+    parser.setOrdering(OrderingStrategy::Gates);
+  } else if (args["--ordering"].asString() != "input") {
+    std::cerr << "Invalid ordering: " << args["--ordering"].asString() << ", using default (input)." << std::endl;
   }
 
   mode definition_mode = mode::both;
@@ -124,50 +268,193 @@ int main(int argc, char* argv[]) {
     definition_mode = mode::both;
   }
 
-  extractor = std::make_unique<Extractor>(args["--conflict-limit"].asLong(), definition_mode);
+  if (args["--output-format"].asString() == "AIGER") {
+    parser.keepDefinitionCircuit();
+  }
 
-  signal(SIGINT,  handle_sighup);
-  signal(SIGTERM, handle_sighup);
-  signal(SIGXCPU, handle_sighup);
+  if (args["--backend"].asString() != "minisat") {
+    std::cerr << "Invalid backend: " << args["--backend"].asString() << ", using default (minisat)." << std::endl;
+  }
+  unique_ptr<DefinabilityCache> cache;
+  if (args["--cache"]) {
+    cache = std::make_unique<DefinabilityCache>(args["--cache"].asString());
+  }
+  SignalWatcher signal_watcher;
+  auto extractor = makeExtractor(args, definition_mode, cache.get());
+  unique_ptr<Extractor> universal_extractor;
+  extractor->setStatistics(statistics);
+  if (args["--concurrent-passes"].asBool()) {
+    // The parser sets up statistics for the universal pass itself.
+    universal_extractor = makeExtractor(args, definition_mode, cache.get());
+    parser.setUniversalExtractor(universal_extractor.get());
+    setRunningExtractors({ extractor.get(), universal_extractor.get() });
+  } else {
+    setRunningExtractors({ extractor.get() });
+  }
 
   try {
-    parser->getDefinitions(*extractor);
+    parser.getDefinitions(*extractor);
   }
   catch (std::bad_alloc&) {
     std::cerr << "Out of memory." << std::endl;
-    extractor.reset();
   }
+  setRunningExtractors({});
+  parser.setUniversalExtractor(nullptr);
+  universal_extractor.reset();
+  extractor.reset();
+  if (cache) {
+    std::cerr << "Cache: " << cache->numberHits() << " hits, " << cache->numberMisses() << " misses." << std::endl;
+  }
+}
 
-  if (args["--output-file"]) {
-    string output_filename = args["--output-file"].asString();
+void writeOutput(std::map<std::string, docopt::value>& args, QBFParser& parser, OutputBuffer& out) {
+  if (simplifyOutput(args)) {
+    parser.simplify();
+  }
+  if (args["--output-format"].asString() == "QDIMACS") {
+    parser.writeQDIMACS(out);
+  } else if (args["--output-format"].asString() == "DIMACS") {
+    parser.writeDIMACS(out);
+  } else if (args["--output-format"].asString() == "QCIR") {
+    parser.writeQCIR(out);
+  } else if (args["--output-format"].asString() == "Verilog") {
+    parser.writeVerilog(out);
+  } else if (args["--output-format"].asString() == "AIGER") {
+    parser.writeAIGER(out);
+  } else {
+    std::cerr << "Invalid output format: " << args["--output-format"].asString() << ", using default (QCIR)." << std::endl;
+    parser.writeQCIR(out);
+  }
+}
+
+int processInstance(std::map<std::string, docopt::value>& args, const string& input_filename, const string& output_filename, const string& stats_filename, const string& trace_filename) {
+  unique_ptr<Statistics> statistics = nullptr;
+  if (!stats_filename.empty() || !trace_filename.empty()) {
+    statistics = std::make_unique<Statistics>();
+  }
+
+  filetype input_filetype = checkFileType(input_filename);
+
+  PhaseTimer parse_timer(statistics.get(), "parse");
+  std::ifstream input_file(input_filename);
+  unique_ptr<QBFParser> parser = makeParser(input_filetype, input_file, input_filename);
+  if (!parser) {
+    return 1;
+  }
+  parse_timer.stop();
+
+  signal(SIGINT,  handle_sighup);
+  signal(SIGTERM, handle_sighup);
+  signal(SIGXCPU, handle_sighup);
+
+  extractDefinitions(args, *parser, statistics.get());
+
+  PhaseTimer write_timer(statistics.get(), "write");
+  int exit_code = 0;
+  if (!output_filename.empty()) {
     std::cerr << "Writing to file: " << output_filename << std::endl;
-    if (args["--output-format"].asString() == "QDIMACS") {
-      parser->writeQDIMACS(output_filename);
-    } else if (args["--output-format"].asString() == "DIMACS") {
-      parser->writeDIMACS(output_filename);
-    } else if (args["--output-format"].asString() == "QCIR") {
-      parser->writeQCIR(output_filename);
-    } else if (args["--output-format"].asString() == "Verilog") {
-      parser->writeVerilog(output_filename);
+    OutputBuffer out(output_filename, args["--mmap-output"].asBool());
+    if (out.good()) {
+      writeOutput(args, *parser, out);
+      out.close();
+      if (!out.good()) {
+        std::cerr << "Error writing file: " << output_filename << std::endl;
+        exit_code = 1;
+      }
     } else {
-      std::cerr << "Invalid output format: " << args["--output-format"].asString() << ", using default (QCIR)." << std::endl;
-      parser->writeQCIR(output_filename);
+      std::cerr << "Error opening file: " << output_filename << std::endl;
+      exit_code = 1;
     }
   } else {
-    if (args["--output-format"].asString() == "QDIMACS") {
-      parser->writeQDIMACS();
-    } else if (args["--output-format"].asString() == "DIMACS") {
-      parser->writeDIMACS();
-    } else if (args["--output-format"].asString() == "QCIR") {
-      parser->writeQCIR();
-    } else if (args["--output-format"].asString() == "Verilog") {
-      parser->writeVerilog();
-    } else {
-      std::cerr << "Invalid output format: " << args["--output-format"].asString() << ", using default (QCIR)." << std::endl;
-      parser->writeQCIR();
+    OutputBuffer out(std::cout);
+    writeOutput(args, *parser, out);
+    out.close();
+    if (!out.good()) {
+      std::cerr << "Error writing output." << std::endl;
+      exit_code = 1;
     }
   }
+  write_timer.stop();
+
+  if (!stats_filename.empty()) {
+    statistics->writeJSON(stats_filename);
+  }
+  if (!trace_filename.empty()) {
+    statistics->writeTrace(trace_filename);
+  }
   
-  return 0;
+  return exit_code;
 }
 
+bool processJob(std::map<std::string, docopt::value> args, const job_options& options, std::istream& input, std::ostream& output) {
+  // Options sent with the job override the command line.
+  for (auto& [option, value]: options) {
+    if (option == "--conflict-limit") {
+      args[option] = docopt::value(std::stol(value));
+    } else {
+      args[option] = docopt::value(value);
+    }
+  }
+  string input_data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  std::istringstream type_stream(input_data);
+  filetype input_filetype = checkFileType(type_stream);
+  std::istringstream input_stream(input_data);
+  unique_ptr<QBFParser> parser = makeParser(input_filetype, input_stream, "<job>");
+  if (!parser) {
+    return false;
+  }
+  extractDefinitions(args, *parser, nullptr);
+  OutputBuffer buffer(output);
+  writeOutput(args, *parser, buffer);
+  buffer.close();
+  return buffer.good();
+}
+
+string outputExtension(const string& output_format) {
+  if (output_format == "QDIMACS") {
+    return ".qdimacs";
+  } else if (output_format == "DIMACS") {
+    return ".cnf";
+  } else if (output_format == "Verilog") {
+    return ".v";
+  } else if (output_format == "AIGER") {
+    return ".aig";
+  } else {
+    return ".qcir";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::map<std::string, docopt::value> args = docopt::docopt(USAGE, { argv + 1, argv + argc }, true, "Unique v.0.1");
+
+  if (args["--batch"]) {
+    if (args["--jobs"].asLong() < 1) {
+      std::cerr << "Invalid number of jobs: " << args["--jobs"].asLong() << std::endl;
+      return 1;
+    }
+    auto instances = BatchRunner::readInstances(args["--batch"].asString());
+    if (instances.empty()) {
+      std::cerr << "No instances found: " << args["--batch"].asString() << std::endl;
+      return 1;
+    }
+    BatchRunner runner(args["--jobs"].asLong(), args["--time-limit"].asLong(), args["--instance-memory-limit"].asLong(), args["--output-dir"].asString());
+    string extension = outputExtension(args["--output-format"].asString());
+    return runner.run(instances, extension, [&args](const string& input_filename, const string& output_filename, const string& stats_filename) {
+      return processInstance(args, input_filename, output_filename, stats_filename, "");
+    });
+  }
+
+  if (args["--daemon"]) {
+    JobServer server(args["--daemon"].asString());
+    signal(SIGINT,  handle_sighup);
+    signal(SIGTERM, handle_sighup);
+    return server.serve([&args](const job_options& options, std::istream& input, std::ostream& output) {
+      return processJob(args, options, input, output);
+    }, sig_caught);
+  }
+
+  string output_filename = args["--output-file"] ? args["--output-file"].asString() : "";
+  string stats_filename = args["--stats-json"] ? args["--stats-json"].asString() : "";
+  string trace_filename = args["--trace-file"] ? args["--trace-file"].asString() : "";
+  return processInstance(args, args["<input file>"].asString(), output_filename, stats_filename, trace_filename);
+}
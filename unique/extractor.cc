@@ -1,57 +1,119 @@
 #include "extractor.h"
 
+#include <deque>
+#include <limits>
 #include <tuple>
 #include <new>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 using std::tuple;
 
-Extractor::Extractor(int conflict_limit, mode definition_mode): solver(nullptr), signal_caught(false), auxiliary_start(0), conflict_limit(conflict_limit), definition_mode(definition_mode) {}
+Extractor::Extractor(int conflict_limit, mode definition_mode): solver(nullptr), backend_type(BackendType::MiniSat), signal_caught(false), auxiliary_start(0), conflict_limit(conflict_limit), definition_mode(definition_mode), statistics(nullptr), definition_circuit(nullptr), memory_limit(0), memory_exhausted(false), minimize_definitions(false), preprocess_matrix(false), renumber_variables(false), verbose(true), cache(nullptr), portfolio_size(0), max_rounds(1), nr_raced(0), nr_portfolio_defined(0) {}
 
-Extractor::~Extractor() {
-  delete solver;
-}
+Extractor::~Extractor() {}
 
 void Extractor::interrupt() {
-  if (solver) {
-    solver->interrupt();
-  }
+  // The flag is set first, so that a query that returns because of the interrupt is not taken for a result.
   signal_caught = true;
-}
-
-vector<int> Extractor::copyClause(vector<int>& clause, unordered_set<int>& shared_variables_set, int offset) {
-  vector<int> clause_copy;
-  for (auto literal: clause) {
-    auto variable = abs(literal);
-    assert(variable <= offset);
-    if (shared_variables_set.find(variable) == shared_variables_set.end()) {
-      variable += offset;
-      int sign = (literal > 0) ? 1 : -1;
-      clause_copy.push_back(sign * variable);
-    } else {
-      clause_copy.push_back(literal);
+  if (!solver_lock.test_and_set()) {
+    if (solver) {
+      solver->interrupt();
+    }
+    if (portfolio) {
+      portfolio->interrupt();
     }
+    solver_lock.clear();
   }
-  return clause_copy;
 }
 
-int Extractor::miniSatLiteral(int literal) {
-  return 2 * abs(literal) + (literal < 0);
+void Extractor::setStatistics(Statistics* statistics) {
+  this->statistics = statistics;
 }
 
-void Extractor::makeMiniSatClause(vector<int>& clause) {
-  for (auto& literal: clause) {
-    literal = miniSatLiteral(literal);
-  }
+void Extractor::setDefinitionCircuit(DefinitionCircuit* definition_circuit) {
+  this->definition_circuit = definition_circuit;
+}
+
+void Extractor::setBackend(BackendType backend_type) {
+  this->backend_type = backend_type;
+}
+
+void Extractor::setMinimizeDefinitions(bool minimize_definitions) {
+  this->minimize_definitions = minimize_definitions;
+}
+
+void Extractor::setPreprocessing(bool preprocess_matrix) {
+  this->preprocess_matrix = preprocess_matrix;
+}
+
+void Extractor::setRenumbering(bool renumber_variables) {
+  this->renumber_variables = renumber_variables;
+}
+
+void Extractor::setVerbose(bool verbose) {
+  // Progress reports on standard error, errors are always reported.
+  this->verbose = verbose;
+}
+
+void Extractor::setCache(DefinabilityCache* cache) {
+  this->cache = cache;
+}
+
+void Extractor::setPortfolio(unsigned int portfolio_size) {
+  this->portfolio_size = portfolio_size;
+}
+
+void Extractor::setRounds(unsigned int max_rounds) {
+  this->max_rounds = max_rounds;
+}
+
+int Extractor::getAuxiliaryStart() {
+  // Auxiliary variables of definitions are numbered after this one.
+  return auxiliary_start;
+}
+
+void Extractor::setAuxiliaryStart(int auxiliary_start) {
+  this->auxiliary_start = auxiliary_start;
+}
+
+void Extractor::setMemoryLimit(long memory_limit) {
+  // Given in megabytes, kept in kilobytes like the resident set size.
+  this->memory_limit = memory_limit * 1024;
+}
+
+bool Extractor::memoryLimitReached() {
+  return memory_exhausted;
+}
+
+int Extractor::originalLiteral(int literal) {
+  // A variable and its copy are adjacent in the solver: variable v is 2v - 1, its copy is 2v.
+  return (literal > 0) ? 2 * literal - 1 : 2 * literal + 1;
 }
 
-void Extractor::makeMiniSatFormula(vector<vector<int>>& formula) {
-  for (auto& clause: formula) {
-    makeMiniSatClause(clause);
+int Extractor::copyLiteral(int literal) {
+  return 2 * literal;
+}
+
+void Extractor::addFormula(ClauseArena& formula, int partition, const vector<bool>& shared) {
+  // Partition 1 gets the formula, partition 2 its copy, in which only shared variables are not renamed.
+  // The solver takes clauses as vectors, reuse a single buffer.
+  vector<int> clause_buffer;
+  for (auto clause: formula) {
+    clause_buffer.clear();
+    for (auto literal: clause) {
+      clause_buffer.push_back((partition == 1 || shared[abs(literal)]) ? originalLiteral(literal) : copyLiteral(literal));
+    }
+    solver->addClause(clause_buffer, partition);
+    if (portfolio) {
+      portfolio->addClause(clause_buffer);
+    }
   }
 }
 
-void Extractor::printFormula(vector<vector<int>>& formula) {
-  for (auto& clause: formula) {
+void Extractor::printFormula(ClauseArena& formula) {
+  for (auto clause: formula) {
     for (auto literal: clause) {
       std::cerr << literal << " ";
     }
@@ -59,7 +121,7 @@ void Extractor::printFormula(vector<vector<int>>& formula) {
   }
 }
 
-auto Extractor::definitionsFromCircuit(Aig_Man_t* circuit, vector<int>& defined, vector<int>& input_variables) {
+vector<tuple<vector<int>, int>> Extractor::definitionsFromCircuit(Aig_Man_t* circuit, vector<int>& defined, vector<int>& input_variables) {
   vector<tuple<vector<int>,int>> definitions;
 
   assert(circuit != nullptr);
@@ -140,7 +202,128 @@ auto Extractor::definitionsFromCircuit(Aig_Man_t* circuit, vector<int>& defined,
   return definitions;
 }
 
-tuple<vector<int>, vector<tuple<vector<int>, int>>> Extractor::getDefinitions(vector<vector<int>>& formula, vector<int>& query_variables, vector<int>& shared_variables, vector<bool>& query_mask, int max_variable_int) {
+void Extractor::recordDefinitionSizes(Aig_Man_t* circuit, vector<int>& defined) {
+  Aig_Obj_t* pObj;
+  int i;
+  Aig_ManForEachCo(circuit, pObj, i) {
+    // Count the AND nodes in the cone of this output.
+    Vec_Ptr_t* vNodes = Aig_ManDfsNodes(circuit, &pObj, 1);
+    statistics->setDefinitionSize(defined[i], Vec_PtrSize(vNodes));
+    Vec_PtrFree(vNodes);
+  }
+}
+
+vector<int> Extractor::findComponents(ClauseArena& formula, int max_variable_int, int& nr_components) {
+  // Union-find over variables, two variables are connected if they occur in a common clause.
+  vector<int> parent(max_variable_int + 1);
+  for (int variable = 0; variable <= max_variable_int; variable++) {
+    parent[variable] = variable;
+  }
+  auto find = [&parent](int variable) {
+    while (parent[variable] != variable) {
+      parent[variable] = parent[parent[variable]];
+      variable = parent[variable];
+    }
+    return variable;
+  };
+  vector<bool> occurs(max_variable_int + 1, false);
+  for (auto clause: formula) {
+    if (clause.size() == 0) {
+      continue;
+    }
+    int first_root = find(abs(clause[0]));
+    for (auto literal: clause) {
+      occurs[abs(literal)] = true;
+      int root = find(abs(literal));
+      if (root != first_root) {
+        parent[root] = first_root;
+      }
+    }
+  }
+  // Number components by their smallest variable, variables that do not occur get -1.
+  vector<int> component(max_variable_int + 1, -1);
+  vector<int> root_component(max_variable_int + 1, -1);
+  nr_components = 0;
+  for (int variable = 1; variable <= max_variable_int; variable++) {
+    if (occurs[variable]) {
+      int root = find(variable);
+      if (root_component[root] == -1) {
+        root_component[root] = nr_components++;
+      }
+      component[variable] = root_component[root];
+    }
+  }
+  return component;
+}
+
+vector<int> Extractor::localityOrder(ClauseArena& formula, int max_variable_int) {
+  // Breadth-first search over the clause-variable graph in the manner of Cuthill-McKee: every search starts at an
+  // unvisited variable with the fewest occurrences, and the variables reached from a variable are visited by
+  // increasing number of occurrences. Variables that occur in the same clauses end up with close numbers.
+  vector<unsigned> occurrence_start(max_variable_int + 2, 0);
+  for (auto clause: formula) {
+    for (auto literal: clause) {
+      occurrence_start[abs(literal) + 1]++;
+    }
+  }
+  for (int variable = 1; variable <= max_variable_int + 1; variable++) {
+    occurrence_start[variable] += occurrence_start[variable - 1];
+  }
+  vector<unsigned> occurrences(occurrence_start.back());
+  vector<unsigned> occurrence_end(occurrence_start.begin(), occurrence_start.end() - 1);
+  for (unsigned clause_index = 0; clause_index < formula.size(); clause_index++) {
+    for (auto literal: formula[clause_index]) {
+      occurrences[occurrence_end[abs(literal)]++] = clause_index;
+    }
+  }
+  auto nr_occurrences = [&occurrence_start](int variable) {
+    return occurrence_start[variable + 1] - occurrence_start[variable];
+  };
+  auto by_occurrences = [&nr_occurrences](int first, int second) {
+    return nr_occurrences(first) < nr_occurrences(second);
+  };
+  vector<int> start_variables;
+  for (int variable = 1; variable <= max_variable_int; variable++) {
+    if (nr_occurrences(variable) > 0) {
+      start_variables.push_back(variable);
+    }
+  }
+  std::stable_sort(start_variables.begin(), start_variables.end(), by_occurrences);
+
+  vector<int> order;
+  order.reserve(start_variables.size());
+  vector<bool> visited(max_variable_int + 1, false);
+  vector<bool> clause_visited(formula.size(), false);
+  for (auto start_variable: start_variables) {
+    if (visited[start_variable]) {
+      continue;
+    }
+    visited[start_variable] = true;
+    order.push_back(start_variable);
+    // The order doubles as the queue of the search.
+    for (unsigned head = order.size() - 1; head < order.size(); head++) {
+      auto variable = order[head];
+      auto reached_start = order.size();
+      for (unsigned j = occurrence_start[variable]; j < occurrence_start[variable + 1]; j++) {
+        auto clause_index = occurrences[j];
+        if (clause_visited[clause_index]) {
+          continue;
+        }
+        clause_visited[clause_index] = true;
+        for (auto literal: formula[clause_index]) {
+          if (!visited[abs(literal)]) {
+            visited[abs(literal)] = true;
+            order.push_back(abs(literal));
+          }
+        }
+      }
+      std::stable_sort(order.begin() + reached_start, order.end(), by_occurrences);
+    }
+  }
+  return order;
+}
+
+tuple<vector<int>, vector<tuple<vector<int>, int>>> Extractor::getDefinitions(ClauseArena& formula, vector<int>& query_variables, vector<int>& shared_variables, vector<bool>& query_mask, int max_variable_int) {
 
   int nr_variables_to_check = 0;
   for (auto flag: query_mask) {
@@ -148,78 +331,673 @@ tuple<vector<int>, vector<tuple<vector<int>, int>>> Extractor::getDefinitions(ve
   }
 
   // Immediately return if signal has already been received.
-  if (nr_variables_to_check == 0 || signal_caught) {
+  if (nr_variables_to_check == 0 || signal_caught || memory_exhausted) {
     return std::make_tuple(vector<int>{}, vector<tuple<vector<int>,int>>{});
   }
 
   auxiliary_start = std::max(max_variable_int, auxiliary_start);
 
-  unordered_set<int> shared_variables_set(shared_variables.begin(), shared_variables.end());
-  vector<vector<int>> formula_copy;
-  for (auto& clause: formula) {
-    formula_copy.push_back(copyClause(clause, shared_variables_set, max_variable_int));
-  }
-
   vector<int> defined;
   vector<tuple<vector<int>,int>> definitions;
 
-  int next_selector_variable = 2 * max_variable_int + 1;
+  if (preprocess_matrix) {
+    // Query and shared variables are frozen, all other variables may be eliminated.
+    PhaseTimer preprocess_timer(statistics, "preprocess");
+    MatrixPreprocessor preprocessor(formula, max_variable_int);
+    for (auto variable: query_variables) {
+      preprocessor.freeze(variable);
+    }
+    for (auto variable: shared_variables) {
+      preprocessor.freeze(variable);
+    }
+    auto nr_clauses = formula.size();
+    auto nr_literals = formula.nrLiterals();
+    preprocessor.preprocess().swap(formula);
+    if (verbose) {
+      std::cerr << "Preprocessing eliminated " << preprocessor.numberEliminated() << " variables, " << nr_clauses << " -> " << formula.size() << " clauses, " << nr_literals << " -> " << formula.nrLiterals() << " literals." << std::endl;
+    }
+  }
 
-  makeMiniSatFormula(formula);
-  makeMiniSatFormula(formula_copy);
+  for (auto clause: formula) {
+    if (clause.size() == 0) {
+      if (verbose) {
+        std::cerr << "Matrix unsatisfiable." << std::endl;
+      }
+      return std::make_tuple(defined, definitions);
+    }
+  }
 
-  try {
-    delete solver;
-    solver = new InterpolatingSolver(2 * max_variable_int + 2 * nr_variables_to_check);
-    solver->addFormula(formula, formula_copy);
+  // Variable-disjoint parts of the matrix are checked separately, each with its own (smaller) solver.
+  PhaseTimer decomposition_timer(statistics, "decomposition");
+  int nr_components = 0;
+  auto component = findComponents(formula, max_variable_int, nr_components);
+  // Variables are renumbered from 1 within their component, in input order or (with renumbering) in an order that keeps
+  // related variables close.
+  vector<int> variable_order;
+  if (renumber_variables) {
+    variable_order = localityOrder(formula, max_variable_int);
+  } else {
+    for (int variable = 1; variable <= max_variable_int; variable++) {
+      if (component[variable] != -1) {
+        variable_order.push_back(variable);
+      }
+    }
+  }
+  vector<int> local_variable(max_variable_int + 1, 0);
+  vector<vector<int>> component_variables(nr_components);
+  for (auto variable: variable_order) {
+    component_variables[component[variable]].push_back(variable);
+    local_variable[variable] = component_variables[component[variable]].size();
+  }
+  vector<int> nr_component_queries(nr_components, 0);
+  for (unsigned i = 0; i < query_variables.size(); i++) {
+    if (query_mask[i] && component[query_variables[i]] != -1) {
+      nr_component_queries[component[query_variables[i]]]++;
+    }
+  }
+  // Components without queries are kept as well, the matrix is unsatisfiable if any component is.
+  vector<ClauseArena> component_formulas(nr_components);
+  for (auto clause: formula) {
+    auto& component_formula = component_formulas[component[abs(clause[0])]];
+    for (auto literal: clause) {
+      component_formula.addLiteral(literal > 0 ? local_variable[literal] : -local_variable[-literal]);
+    }
+    component_formula.closeClause();
+  }
+  // The components hold all clauses that are needed from here on.
+  ClauseArena().swap(formula);
+  decomposition_timer.stop();
+  if (nr_components > 1 && verbose) {
+    std::cerr << "Matrix has " << nr_components << " connected components." << std::endl;
+  }
 
-    if (!solver->solve()) {
-      std::cerr << "Matrix unsatisfiable." << std::endl;
-      return std::make_tuple(defined, definitions);
+  // If a later component is unsatisfiable, the definitions of earlier ones are dropped. Their circuits are collected
+  // separately and only added to the definition circuit once all components are done. The cache keeps them, they are
+  // definitions with respect to their component.
+  DefinitionCircuit* output_circuit = definition_circuit;
+  unique_ptr<DefinitionCircuit> components_circuit;
+  if (definition_circuit && nr_components > 1) {
+    components_circuit = std::make_unique<DefinitionCircuit>();
+    definition_circuit = components_circuit.get();
+  }
+  bool satisfiable = true;
+  int checked = 0;
+  for (int c = 0; c < nr_components && !signal_caught && !memory_exhausted; c++) {
+    if (nr_component_queries[c] == 0) {
+      // Only checked for satisfiability.
+      satisfiable = isSatisfiable(component_formulas[c], component_variables[c].size());
+    } else {
+      // Query and shared variables of this component, in their original order.
+      vector<int> component_query_variables, component_shared_variables;
+      vector<bool> component_query_mask;
+      for (unsigned i = 0; i < query_variables.size(); i++) {
+        if (component[query_variables[i]] == c) {
+          component_query_variables.push_back(local_variable[query_variables[i]]);
+          component_query_mask.push_back(query_mask[i]);
+        }
+      }
+      for (auto variable: shared_variables) {
+        if (component[variable] == c) {
+          component_shared_variables.push_back(local_variable[variable]);
+        }
+      }
+      try {
+        satisfiable = getComponentDefinitions(component_formulas[c], component_query_variables, component_shared_variables, component_query_mask, component_variables[c], checked, nr_variables_to_check, defined, definitions);
+      }
+      catch (...) {
+        definition_circuit = output_circuit;
+        throw;
+      }
+    }
+    ClauseArena().swap(component_formulas[c]);
+    if (!satisfiable) {
+      if (verbose) {
+        std::cerr << "Matrix unsatisfiable." << std::endl;
+      }
+      defined.clear();
+      definitions.clear();
+      break;
+    }
+  }
+  definition_circuit = output_circuit;
+  if (components_circuit && satisfiable) {
+    definition_circuit->append(*components_circuit);
+  }
+  if (verbose) {
+    std::cerr << std::endl;
+  }
+  if (nr_raced > 0) {
+    if (verbose) {
+      std::cerr << "Portfolio decided " << nr_portfolio_defined << " of " << nr_raced << " raced variables as defined." << std::endl;
+    }
+    nr_raced = 0;
+    nr_portfolio_defined = 0;
+  }
+  return std::make_tuple(defined, definitions);
+}
+
+void Extractor::addCircuitDefinitions(Aig_Man_t* circuit, vector<int>& circuit_defined, vector<int>& shared_variables, vector<int>& global_variables, vector<int>& defined, vector<tuple<vector<int>,int>>& definitions) {
+  // Circuit inputs and outputs are translated back to the original variables.
+  vector<int> global_defined, global_shared;
+  for (auto variable: circuit_defined) {
+    global_defined.push_back(global_variables[variable - 1]);
+  }
+  for (auto variable: shared_variables) {
+    global_shared.push_back(global_variables[variable - 1]);
+  }
+  defined.insert(defined.end(), global_defined.begin(), global_defined.end());
+  if (circuit != nullptr) {
+    auto circuit_definitions = definitionsFromCircuit(circuit, global_defined, global_shared);
+    definitions.insert(definitions.end(), std::make_move_iterator(circuit_definitions.begin()), std::make_move_iterator(circuit_definitions.end()));
+    if (statistics) {
+      recordDefinitionSizes(circuit, global_defined);
+    }
+    if (definition_circuit) {
+      definition_circuit->addCircuit(circuit, global_defined, global_shared);
     }
+  }
+}
+
+bool Extractor::getComponentDefinitions(ClauseArena& formula, vector<int>& query_variables, vector<int>& shared_variables, vector<bool>& query_mask, vector<int>& global_variables, int& checked, int nr_variables_to_check, vector<int>& defined, vector<tuple<vector<int>,int>>& definitions) {
+  // Variables are local to the component, global_variables[v - 1] is the original variable of v.
+  int max_variable_int = global_variables.size();
+  int nr_component_queries = 0;
+  for (auto flag: query_mask) {
+    nr_component_queries += flag;
+  }
 
-    next_selector_variable = 2 * max_variable_int + 1;
+  // A cached result depends on the conflict limit and the cone of the query variable at the time of the query (see
+  // QueryCones), cached definitions are over the shared variables of the cone.
+  CacheKey settings_key = { 0, 0 };
+  unique_ptr<QueryCones> cones;
+  if (cache) {
+    settings_key = DefinabilityCache::extendKey(settings_key, conflict_limit);
+    // The portfolio decides more variables, its results are kept apart (and results without it stay valid).
+    if (portfolio_size > 0 && conflict_limit > 0) {
+      settings_key = DefinabilityCache::extendKey(settings_key, -int64_t(portfolio_size));
+    }
+    // So are the results of further rounds (the marker differs from any portfolio size).
+    if (max_rounds > 1 && conflict_limit > 0) {
+      settings_key = DefinabilityCache::extendKey(settings_key, -(int64_t(max_rounds) << 32));
+    }
+    cones = std::make_unique<QueryCones>(formula, global_variables);
+  }
+  // Cached definitions that do not hold on this formula.
+  unsigned int nr_rejected = 0;
 
-    int checked = 0;
-    for (int i = 0; i < query_variables.size() && !signal_caught; i++) {
+  auto double_limit = [](int limit) {
+    return (limit <= std::numeric_limits<int>::max() / 2) ? 2 * limit : std::numeric_limits<int>::max();
+  };
+  // With further rounds, variables the solver gave up on are queried again with twice the conflict limit. Usually,
+  // this happens on the same solver (see below). With --mode other-defined, a variable may also use variables defined
+  // after its first query, but all queries on a solver must share prefixes of the same list of variables. Further
+  // rounds then query the undecided variables again on a fresh solver, sharing the variables defined so far (which
+  // amounts to substituting their definitions).
+  bool extraction_rounds = max_rounds > 1 && conflict_limit > 0 && definition_mode == mode::other_defined;
+  unsigned int extraction_round = 1;
+  int extraction_conflict_limit = conflict_limit;
+  vector<int> round_query_variables = query_variables;
+  vector<bool> round_query_mask = query_mask;
+  vector<int> initial_shared_variables = shared_variables;
+  vector<bool> is_defined_variable(max_variable_int + 1, false);
+  unsigned int nr_round_defined = 0;
+  // Variables still undecided, with the key of their last query.
+  vector<tuple<int, CacheKey>> undecided;
+  auto start_round = [&]() {
+    if (!extraction_rounds || extraction_round == max_rounds || undecided.empty()) {
+      return false;
+    }
+    if (extraction_round > 1 && nr_round_defined == 0) {
+      if (verbose) {
+        std::cerr << "No new definitions found." << std::endl;
+      }
+      return false;
+    }
+    extraction_round++;
+    extraction_conflict_limit = double_limit(extraction_conflict_limit);
+    if (verbose) {
+      std::cerr << "Round " << extraction_round << ": querying " << undecided.size() << " variables again (conflict limit " << extraction_conflict_limit << ")." << std::endl;
+    }
+    vector<bool> is_undecided(max_variable_int + 1, false);
+    for (auto& [variable, _]: undecided) {
+      is_undecided[variable] = true;
+    }
+    undecided.clear();
+    // Defined variables are shared like the variables that are not queried.
+    round_query_variables.clear();
+    round_query_mask.clear();
+    for (unsigned int i = 0; i < query_variables.size(); i++) {
       auto variable = query_variables[i];
-      bool is_defined = false;
-      if (query_mask[i]) {
-        auto selector_A = next_selector_variable++;
-        auto selector_B = next_selector_variable++;
-        vector<int> selector_clause_A = { -selector_A, variable };
-        vector<int> selector_clause_B = { -selector_B, -(variable + max_variable_int) };
-        makeMiniSatClause(selector_clause_A);
-        makeMiniSatClause(selector_clause_B);
-        solver->addClause(selector_clause_A, 1);
-        solver->addClause(selector_clause_B, 2);
-        vector<int> assumptions = { miniSatLiteral(selector_A), miniSatLiteral(selector_B) };
-        if (!solver->getInterpolant(variable, assumptions, shared_variables, conflict_limit)) {
-          defined.push_back(variable);
-          is_defined = true;
-        }
-        std::cerr << ++checked << "/" << nr_variables_to_check << " checked. \r";
-      }
-      if (!query_mask[i] || definition_mode == mode::both || (definition_mode == mode::other_defined && is_defined)) {
-        vector<int> c1 = { variable, -(variable + max_variable_int) };
-        vector<int> c2 = { -variable, (variable + max_variable_int) };
-        makeMiniSatClause(c1);
-        makeMiniSatClause(c2);
-        solver->addClause(c1);
-        solver->addClause(c2);
-        formula_copy.push_back(c1);
-        formula_copy.push_back(c2);
-        shared_variables.push_back(variable);
+      if (!query_mask[i] || is_defined_variable[variable] || is_undecided[variable]) {
+        round_query_variables.push_back(variable);
+        round_query_mask.push_back(is_undecided[variable]);
       }
     }
-    std::cerr << std::endl;
-    auto circuit = solver->getCircuit(shared_variables, !signal_caught);
-    if (circuit != nullptr) {
-      definitions = definitionsFromCircuit(circuit, defined, shared_variables);
+    shared_variables = initial_shared_variables;
+    nr_round_defined = 0;
+    return true;
+  };
+
+  // Queries are answered in segments, each with a fresh solver. A new segment is only started if the memory limit
+  // is nearly reached, which drops the solver's learnt clauses and proof, or for a further round (see above).
+  // Variables that were made shared by earlier segments are shared in the copy of the formula.
+  unsigned int next_query = 0;
+  // Set once a solver has been loaded, which checks that the formula is satisfiable.
+  bool satisfiability_checked = false;
+  while (!signal_caught && !memory_exhausted) {
+    if (next_query == round_query_variables.size()) {
+      if (!start_round()) {
+        break;
+      }
+      next_query = 0;
+    } else if (next_query > 0 && verbose) {
+      std::cerr << "Memory limit nearly reached, restarting solver." << std::endl;
+    }
+
+    // The solver works on interleaved variables (see originalLiteral), the circuit inputs follow solver_shared_variables.
+    vector<int> solver_shared_variables;
+    // Variables queried again on the same solver must not use the equalities of later variables, so equalities added
+    // to the solver are guarded by activation variables (see below).
+    bool rounds = max_rounds > 1 && conflict_limit > 0 && !extraction_rounds;
+    int nr_activation_variables = rounds ? round_query_variables.size() : 0;
+    int next_activation_variable = 2 * max_variable_int + 1;
+    int last_activation = 0;
+    int next_selector_variable = 2 * max_variable_int + nr_activation_variables + 1;
+    // With a cache, the solver is only loaded once a query misses the cache.
+    auto load_solver = [&]() {
+      PhaseTimer load_timer(statistics, "load");
+      vector<bool> shared(max_variable_int + 1, false);
+      solver_shared_variables.clear();
+      for (auto variable: shared_variables) {
+        shared[variable] = true;
+        solver_shared_variables.push_back(originalLiteral(variable));
+      }
+      unique_ptr<SolverPortfolio> new_portfolio;
+      if (portfolio_size > 0 && conflict_limit > 0) {
+        // Without a conflict limit the interpolating solver decides every variable itself.
+        new_portfolio = std::make_unique<SolverPortfolio>(portfolio_size, 2 * max_variable_int + nr_activation_variables);
+      }
+      // Only the portfolio and further rounds need to tell counterexamples from reaching the conflict limit.
+      bool decide_failed_queries = conflict_limit > 0 && (portfolio_size > 0 || max_rounds > 1);
+      setSolver(InterpolationBackend::create(backend_type, 2 * max_variable_int + nr_activation_variables + 2 * nr_component_queries, decide_failed_queries), std::move(new_portfolio));
+      addFormula(formula, 1, shared);
+      addFormula(formula, 2, shared);
+      satisfiability_checked = true;
+      return solver->solve();
+    };
+    // Variables on which the solver gives up are raced on the portfolio. If they turn out to be defined, the solver
+    // computes the definition under the portfolio's limit, and if it reaches that limit as well the variable is not defined.
+    auto query = [&](int variable, int selector_A, int selector_B, int activation, vector<int>& query_shared_variables, int query_conflict_limit) {
+      vector<int> assumptions = { selector_A, selector_B };
+      if (activation != 0) {
+        assumptions.push_back(activation);
+      }
+      auto result = solver->getInterpolant(originalLiteral(variable), assumptions, query_shared_variables, query_conflict_limit);
+      if (result == QueryResult::Unknown && portfolio && !signal_caught) {
+        result = raceVariable(variable, activation, query_conflict_limit);
+        if (result == QueryResult::Defined) {
+          result = solver->getInterpolant(originalLiteral(variable), assumptions, query_shared_variables, portfolioConflictLimit(query_conflict_limit));
+          nr_portfolio_defined += (result == QueryResult::Defined);
+        }
+      }
+      return result;
+    };
+    // Positions of the shared variables in shared_variables (and thus of the circuit inputs), -1 if not shared.
+    vector<int> shared_position(max_variable_int + 1, -1);
+    for (unsigned int i = 0; i < shared_variables.size(); i++) {
+      shared_position[shared_variables[i]] = i;
     }
+
+    // Variables defined by the solver (in the order of the circuit outputs), with the key, number of shared variables
+    // and positions of the shared variables of the cone of their query. All variables defined in this segment, with
+    // the cached definition if there is one (over all shared variables of the query, in cached_definitions).
+    vector<int> component_defined;
+    vector<tuple<CacheKey, unsigned int, vector<int>>> solver_queries;
+    vector<int> segment_defined;
+    vector<const CachedDefinition*> segment_cached;
+    std::deque<CachedDefinition> cached_definitions;
+    unsigned int segment_start = next_query;
+    // Queries the solver gave up on, to be repeated in further rounds with the same selectors and shared variables.
+    struct Requery {
+      int variable;
+      int selector_A;
+      int selector_B;
+      unsigned int nr_shared;
+      int activation;
+      CacheKey query_key;
+      vector<int> cone_positions;
+    };
+    vector<Requery> requeries;
+
+    try {
+      if (!cache && !load_solver()) {
+        releaseSolver();
+        return false;
+      }
+
+      PhaseTimer query_timer(statistics, "queries");
+
+      for (; next_query < round_query_variables.size() && !signal_caught; next_query++) {
+        auto i = next_query;
+        auto variable = round_query_variables[i];
+        bool is_defined = false;
+        if (round_query_mask[i]) {
+          if (memoryLimitNear()) {
+            // A fresh solver did not help, give up on the remaining variables.
+            memory_exhausted = (i == segment_start);
+            break;
+          }
+          if (statistics) {
+            statistics->startVariable(global_variables[variable - 1]);
+          }
+          CacheKey query_key = { 0, 0 };
+          vector<int> cone_positions;
+          const CachedDefinition* cached = nullptr;
+          if (cache) {
+            vector<int> cone_shared_variables;
+            auto cone_key = cones->coneKey(variable, shared_position, cone_shared_variables);
+            query_key = DefinabilityCache::extendKey(DefinabilityCache::extendKey(settings_key, cone_key.first), cone_key.second);
+            for (auto shared_variable: cone_shared_variables) {
+              cone_positions.push_back(shared_position[shared_variable]);
+            }
+            cached = cache->find(query_key);
+            if (cached && cached->defined) {
+              // Constraints outside of the cone may differ from the run that found the definition, it is only used if
+              // it holds on this formula (otherwise the variable is queried).
+              cached_definitions.emplace_back();
+              if (DefinabilityCache::remapInputs(*cached, cone_positions, shared_variables.size(), cached_definitions.back()) && cones->holds(variable, cached_definitions.back(), shared_variables, CACHE_CHECK_CONFLICT_LIMIT)) {
+                cached = &cached_definitions.back();
+              } else {
+                cached_definitions.pop_back();
+                cached = nullptr;
+                nr_rejected++;
+              }
+            }
+          }
+          if (cached) {
+            is_defined = cached->defined;
+            if (is_defined) {
+              segment_defined.push_back(variable);
+              segment_cached.push_back(cached);
+            }
+          } else {
+            if (!solver && !load_solver()) {
+              releaseSolver();
+              return false;
+            }
+            auto selector_A = next_selector_variable++;
+            auto selector_B = next_selector_variable++;
+            vector<int> selector_clause_A = { -selector_A, originalLiteral(variable) };
+            vector<int> selector_clause_B = { -selector_B, -copyLiteral(variable) };
+            solver->addClause(selector_clause_A, 1);
+            solver->addClause(selector_clause_B, 2);
+            auto result = query(variable, selector_A, selector_B, last_activation, solver_shared_variables, extraction_conflict_limit);
+            if (result == QueryResult::Defined) {
+              component_defined.push_back(variable);
+              solver_queries.push_back(std::make_tuple(query_key, shared_variables.size(), cone_positions));
+              segment_defined.push_back(variable);
+              segment_cached.push_back(nullptr);
+              is_defined = true;
+            } else if (rounds && result == QueryResult::Unknown) {
+              // Cached once it is still undecided after the last round.
+              requeries.push_back({ variable, selector_A, selector_B, static_cast<unsigned int>(solver_shared_variables.size()), last_activation, query_key, cone_positions });
+            } else if (extraction_rounds && result == QueryResult::Unknown) {
+              undecided.push_back(std::make_tuple(variable, query_key));
+            } else if (cache && (result == QueryResult::NotDefined || !signal_caught)) {
+              // Reaching the conflict limit is a result for the cached configuration, being interrupted is not.
+              cache->store(query_key, CachedDefinition{ false, 0, {} });
+            }
+          }
+          if (statistics) {
+            statistics->endVariable(is_defined);
+          }
+          if (is_defined) {
+            is_defined_variable[variable] = true;
+            nr_round_defined++;
+          }
+          if (extraction_round == 1) {
+            checked++;
+            if (verbose) {
+              std::cerr << checked << "/" << nr_variables_to_check << " checked. \r";
+            }
+          }
+        }
+        if (!round_query_mask[i] || definition_mode == mode::both || (definition_mode == mode::other_defined && is_defined)) {
+          if (solver) {
+            vector<int> c1 = { originalLiteral(variable), -copyLiteral(variable) };
+            vector<int> c2 = { -originalLiteral(variable), copyLiteral(variable) };
+            if (rounds) {
+              // Activation variables form a chain, assuming the last one activates all equalities added so far.
+              auto activation = next_activation_variable++;
+              c1.push_back(-activation);
+              c2.push_back(-activation);
+              if (last_activation != 0) {
+                vector<int> chain = { -activation, last_activation };
+                solver->addClause(chain);
+                if (portfolio) {
+                  portfolio->addClause(chain);
+                }
+              }
+              last_activation = activation;
+            }
+            solver->addClause(c1);
+            solver->addClause(c2);
+            if (portfolio) {
+              portfolio->addClause(c1);
+              portfolio->addClause(c2);
+            }
+          }
+          shared_position[variable] = shared_variables.size();
+          shared_variables.push_back(variable);
+          solver_shared_variables.push_back(originalLiteral(variable));
+        }
+      }
+
+      // Further rounds ask the solver again (keeping its learnt clauses) with twice the conflict limit, each variable
+      // with the equalities of the variables shared before it in the first round, until a round defines none of them.
+      int round_conflict_limit = conflict_limit;
+      for (unsigned int round = 2; round <= max_rounds && !requeries.empty(); round++) {
+        if (signal_caught || memoryLimitNear()) {
+          break;
+        }
+        round_conflict_limit = double_limit(round_conflict_limit);
+        if (verbose) {
+          std::cerr << "Round " << round << ": querying " << requeries.size() << " variables again (conflict limit " << round_conflict_limit << ")." << std::endl;
+        }
+        vector<Requery> undecided;
+        unsigned int nr_defined = 0;
+        for (unsigned int j = 0; j < requeries.size(); j++) {
+          auto& requery = requeries[j];
+          if (signal_caught || memoryLimitNear()) {
+            undecided.insert(undecided.end(), requeries.begin() + j, requeries.end());
+            break;
+          }
+          if (statistics) {
+            statistics->startVariable(global_variables[requery.variable - 1]);
+          }
+          vector<int> query_shared_variables(solver_shared_variables.begin(), solver_shared_variables.begin() + requery.nr_shared);
+          auto result = query(requery.variable, requery.selector_A, requery.selector_B, requery.activation, query_shared_variables, round_conflict_limit);
+          if (result == QueryResult::Defined) {
+            component_defined.push_back(requery.variable);
+            solver_queries.push_back(std::make_tuple(requery.query_key, requery.nr_shared, requery.cone_positions));
+            segment_defined.push_back(requery.variable);
+            segment_cached.push_back(nullptr);
+            nr_defined++;
+          } else if (result == QueryResult::Unknown) {
+            undecided.push_back(requery);
+          } else if (cache) {
+            cache->store(requery.query_key, CachedDefinition{ false, 0, {} });
+          }
+          if (statistics) {
+            statistics->endVariable(result == QueryResult::Defined);
+          }
+        }
+        requeries.swap(undecided);
+        if (nr_defined == 0) {
+          if (verbose) {
+            std::cerr << "No new definitions found." << std::endl;
+          }
+          break;
+        }
+      }
+      if (cache && !signal_caught && !memoryLimitNear()) {
+        for (auto& requery: requeries) {
+          cache->store(requery.query_key, CachedDefinition{ false, 0, {} });
+        }
+      }
+      query_timer.stop();
+      // If the cache answered all queries so far, no solver has checked the formula.
+      if (!satisfiability_checked && !signal_caught) {
+        if (!isSatisfiable(formula, max_variable_int)) {
+          return false;
+        }
+        satisfiability_checked = true;
+      }
+      Aig_Man_t* circuit = nullptr;
+      if (solver) {
+        PhaseTimer circuit_timer(statistics, "circuit");
+        circuit = solver->getCircuit(solver_shared_variables, !signal_caught);
+      }
+      // The minimized circuit is owned by the extractor, the original one by the solver.
+      Aig_Man_t* minimized_circuit = nullptr;
+      if (circuit != nullptr && minimize_definitions && !signal_caught && !memoryLimitNear()) {
+        PhaseTimer minimize_timer(statistics, "minimize");
+        DefinitionMinimizer minimizer(formula, max_variable_int, MINIMIZATION_CONFLICT_LIMIT);
+        minimized_circuit = minimizer.minimize(circuit, shared_variables);
+        if (minimized_circuit != nullptr) {
+          if (verbose) {
+            std::cerr << "Minimization reduced definitions from " << Aig_ManNodeNum(circuit) << " to " << Aig_ManNodeNum(minimized_circuit) << " AND nodes." << std::endl;
+          }
+          circuit = minimized_circuit;
+        }
+      }
+      // Definitions are cached over the shared variables of the cone of their query (minimization does not add later
+      // ones). A definition that uses other shared variables is not cached.
+      if (cache && circuit != nullptr && !signal_caught) {
+        CachedDefinition result, cone_result;
+        vector<int> positions;
+        for (unsigned int j = 0; j < solver_queries.size(); j++) {
+          auto& [query_key, nr_inputs, cone_positions] = solver_queries[j];
+          positions.assign(nr_inputs, -1);
+          for (unsigned int k = 0; k < cone_positions.size(); k++) {
+            positions[cone_positions[k]] = k;
+          }
+          if (DefinabilityCache::fromCircuit(circuit, j, nr_inputs, result) && DefinabilityCache::remapInputs(result, positions, cone_positions.size(), cone_result)) {
+            cache->store(query_key, cone_result);
+          }
+        }
+      }
+      // Cached and computed definitions are collected in one circuit in the order in which they were found (the
+      // order of the circuit outputs for computed ones), definitions of later rounds come last.
+      if (segment_defined.size() > component_defined.size()) {
+        vector<CachedDefinition> solver_definitions(component_defined.size());
+        vector<int> combined_defined;
+        vector<const CachedDefinition*> combined_definitions;
+        for (unsigned int j = 0, k = 0; j < segment_defined.size(); j++) {
+          auto definition = segment_cached[j];
+          if (definition == nullptr) {
+            if (circuit == nullptr) {
+              // Interrupted, no definition.
+              defined.push_back(global_variables[segment_defined[j] - 1]);
+              continue;
+            }
+            [[maybe_unused]] bool converted = DefinabilityCache::fromCircuit(circuit, k, shared_variables.size(), solver_definitions[k]);
+            assert(converted);
+            definition = &solver_definitions[k++];
+          }
+          combined_defined.push_back(segment_defined[j]);
+          combined_definitions.push_back(definition);
+        }
+        auto combined_circuit = DefinabilityCache::toCircuit(combined_definitions, shared_variables.size());
+        addCircuitDefinitions(combined_circuit, combined_defined, shared_variables, global_variables, defined, definitions);
+        Aig_ManStop(combined_circuit);
+      } else {
+        addCircuitDefinitions(circuit, component_defined, shared_variables, global_variables, defined, definitions);
+      }
+      if (minimized_circuit != nullptr) {
+        Aig_ManStop(minimized_circuit);
+      }
+    }
+    catch (std::bad_alloc&) {
+      std::cerr << "Out of memory." << std::endl;
+      memory_exhausted = true;
+    }
+    releaseSolver();
   }
-  catch (Minisat::OutOfMemoryException&) {
-    std::cerr << "MiniSat out of memory." << std::endl;
+  if (cache && !signal_caught && !memory_exhausted) {
+    for (auto& [variable, query_key]: undecided) {
+      cache->store(query_key, CachedDefinition{ false, 0, {} });
+    }
   }
-  return std::make_tuple(defined, definitions);
-}
\ No newline at end of file
+  if (nr_rejected > 0 && verbose) {
+    std::cerr << nr_rejected << " cached definitions do not hold on this matrix and were computed again." << std::endl;
+  }
+  if (memory_exhausted) {
+    std::cerr << "Memory limit reached, " << nr_variables_to_check - checked << " variables not checked." << std::endl;
+  }
+  return true;
+}
+
+bool Extractor::isSatisfiable(ClauseArena& formula, int max_variable_int) {
+  // An interrupted check does not make the formula unsatisfiable.
+  setSolver(InterpolationBackend::create(backend_type, 2 * max_variable_int), nullptr);
+  addFormula(formula, 1, vector<bool>(max_variable_int + 1, false));
+  bool satisfiable = solver->solve() || signal_caught;
+  releaseSolver();
+  return satisfiable;
+}
+
+bool Extractor::memoryLimitNear() {
+  // Leave some headroom for extracting the circuit of the current segment.
+  return memory_limit > 0 && Statistics::residentMemory() > memory_limit / 10 * 9;
+}
+
+int Extractor::portfolioConflictLimit(int limit) {
+  if (limit > std::numeric_limits<int>::max() / PORTFOLIO_CONFLICT_FACTOR) {
+    return std::numeric_limits<int>::max();
+  }
+  return PORTFOLIO_CONFLICT_FACTOR * limit;
+}
+
+QueryResult Extractor::raceVariable(int variable, int activation, int limit) {
+  // The variable is defined if it cannot differ from its copy (under the equalities activated by activation, if any).
+  // Each instance of the portfolio gets the larger limit.
+  nr_raced++;
+  vector<int> assumptions = { originalLiteral(variable), -copyLiteral(variable) };
+  if (activation != 0) {
+    assumptions.push_back(activation);
+  }
+  auto result = portfolio->race(assumptions, portfolioConflictLimit(limit));
+  if (result == l_False) {
+    return QueryResult::Defined;
+  } else if (result == l_True) {
+    return QueryResult::NotDefined;
+  }
+  return QueryResult::Unknown;
+}
+
+void Extractor::setSolver(unique_ptr<InterpolationBackend> new_solver, unique_ptr<SolverPortfolio> new_portfolio) {
+  // interrupt() may run at any time (in a signal handler on another thread), it does not wait for the lock.
+  while (solver_lock.test_and_set()) {}
+  solver.swap(new_solver);
+  portfolio.swap(new_portfolio);
+  solver_lock.clear();
+  // An interrupt that skipped the solvers is passed on to the new ones.
+  if (signal_caught) {
+    if (solver) {
+      solver->interrupt();
+    }
+    if (portfolio) {
+      portfolio->interrupt();
+    }
+  }
+  // The old solvers are deleted on return, after the lock is released.
+}
+
+void Extractor::releaseSolver() {
+  setSolver(nullptr, nullptr);
+#ifdef __GLIBC__
+  // Return the freed memory to the system, otherwise the resident set size does not go down.
+  malloc_trim(0);
+#endif
+}
@@ -1,13 +1,21 @@
 #ifndef Extractor_HH
 #define Extractor_HH
 
+#include <atomic>
+#include <memory>
 #include <vector>
-#include <unordered_set>
 
-#include "InterpolatingSolver.h"
+#include "InterpolationBackend.h"
+#include "Statistics.h"
+#include "DefinitionCircuit.h"
+#include "DefinitionMinimizer.h"
+#include "MatrixPreprocessor.h"
+#include "DefinabilityCache.h"
+#include "SolverPortfolio.h"
+#include "ClauseArena.h"
 
 using std::vector;
-using std::unordered_set;
+using std::unique_ptr;
 
 using namespace avy::abc;
 
@@ -18,21 +26,70 @@ public:
   Extractor(int conflict_limit, mode definition_mode);
   ~Extractor();
   void interrupt();
-  tuple<vector<int>, vector<tuple<vector<int>, int>>> getDefinitions(vector<vector<int>>& formula, vector<int>& query_variables, vector<int>& shared_variables, vector<bool>& query_mask, int max_variable_int);
+  void setStatistics(Statistics* statistics);
+  void setDefinitionCircuit(DefinitionCircuit* definition_circuit);
+  void setBackend(BackendType backend_type);
+  void setMinimizeDefinitions(bool minimize_definitions);
+  void setPreprocessing(bool preprocess_matrix);
+  void setRenumbering(bool renumber_variables);
+  void setVerbose(bool verbose);
+  void setCache(DefinabilityCache* cache);
+  void setPortfolio(unsigned int portfolio_size);
+  void setRounds(unsigned int max_rounds);
+  int getAuxiliaryStart();
+  void setAuxiliaryStart(int auxiliary_start);
+  void setMemoryLimit(long memory_limit);
+  bool memoryLimitReached();
+  tuple<vector<int>, vector<tuple<vector<int>, int>>> getDefinitions(ClauseArena& formula, vector<int>& query_variables, vector<int>& shared_variables, vector<bool>& query_mask, int max_variable_int);
 
 protected:
-  vector<int> copyClause(vector<int>& clause, unordered_set<int>& shared_variables_set, int offset);
-  int miniSatLiteral(int literal);
-  void makeMiniSatClause(vector<int>& clause);
-  void makeMiniSatFormula(vector<vector<int>>& formula);
-  void printFormula(vector<vector<int>>& formula);
-  auto definitionsFromCircuit(Aig_Man_t* circuit, vector<int>& defined, vector<int>& input_variables);
-
-  InterpolatingSolver* solver;
-  bool signal_caught;
+  static int originalLiteral(int literal);
+  static int copyLiteral(int literal);
+  void addFormula(ClauseArena& formula, int partition, const vector<bool>& shared);
+  void printFormula(ClauseArena& formula);
+  vector<tuple<vector<int>, int>> definitionsFromCircuit(Aig_Man_t* circuit, vector<int>& defined, vector<int>& input_variables);
+  void recordDefinitionSizes(Aig_Man_t* circuit, vector<int>& defined);
+  void addCircuitDefinitions(Aig_Man_t* circuit, vector<int>& circuit_defined, vector<int>& shared_variables, vector<int>& global_variables, vector<int>& defined, vector<tuple<vector<int>,int>>& definitions);
+  vector<int> findComponents(ClauseArena& formula, int max_variable_int, int& nr_components);
+  vector<int> localityOrder(ClauseArena& formula, int max_variable_int);
+  bool isSatisfiable(ClauseArena& formula, int max_variable_int);
+  bool memoryLimitNear();
+  void setSolver(unique_ptr<InterpolationBackend> new_solver, unique_ptr<SolverPortfolio> new_portfolio);
+  void releaseSolver();
+  int portfolioConflictLimit(int limit);
+  QueryResult raceVariable(int variable, int activation, int limit);
+  bool getComponentDefinitions(ClauseArena& formula, vector<int>& query_variables, vector<int>& shared_variables, vector<bool>& query_mask, vector<int>& global_variables, int& checked, int nr_variables_to_check, vector<int>& defined, vector<tuple<vector<int>,int>>& definitions);
+
+  unique_ptr<InterpolationBackend> solver;
+  unique_ptr<SolverPortfolio> portfolio;
+  BackendType backend_type;
+  // Set by interrupt() before the solvers are interrupted, which may happen in a signal handler.
+  std::atomic<bool> signal_caught;
+  // Held while the solvers are replaced, interrupt() skips them then.
+  std::atomic_flag solver_lock = ATOMIC_FLAG_INIT;
   int auxiliary_start;
   int conflict_limit;
   mode definition_mode;
+  Statistics* statistics;
+  DefinitionCircuit* definition_circuit;
+  long memory_limit;
+  bool memory_exhausted;
+  bool minimize_definitions;
+  bool preprocess_matrix;
+  bool renumber_variables;
+  bool verbose;
+  DefinabilityCache* cache;
+  unsigned int portfolio_size;
+  unsigned int max_rounds;
+  unsigned int nr_raced;
+  unsigned int nr_portfolio_defined;
+
+  static const int MINIMIZATION_CONFLICT_LIMIT = 100;
+  // Cached definitions that are not confirmed on the formula within this limit are computed again.
+  static const int CACHE_CHECK_CONFLICT_LIMIT = 10000;
+  // Variables on which the interpolating solver gives up are raced with a conflict limit this many times larger, and
+  // the definitions of those found defined are computed under that limit.
+  static const int PORTFOLIO_CONFLICT_FACTOR = 10;
   
 };
 
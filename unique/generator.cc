@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <docopt.h>
+
+using std::string;
+using std::vector;
+
+static const char USAGE[] =
+R"(Usage:
+  unique_generator [options]
+
+Options:
+  -h --help                     shows this screen
+  -f --format <format>          Output format [default: QDIMACS]
+                                (QDIMACS | QCIR | DQDIMACS)
+  -v --variables <int>          number of variables [default: 100]
+  -c --clauses <int>            number of random clauses [default: 200]
+  -k --clause-size <int>        number of literals in random clauses [default: 3]
+  -b --blocks <int>             number of quantifier blocks (QDIMACS and QCIR) [default: 2]
+  -d --dependencies <int>       size of dependency sets (DQDIMACS) [default: 4]
+  --dependency-sets <int>       number of distinct dependency sets (DQDIMACS) [default: 4]
+  -p --planted <int>            number of planted definitions [default: 10]
+  -s --seed <int>               random seed [default: 0]
+  -o --output-file <filename>   writes instance to the given file (instead of standard output)
+)";
+
+enum class format: int { QDIMACS, QCIR, DQDIMACS };
+
+/*
+  Generates random instances with a prescribed number of definitions: a planted definition
+  y <-> (l1 & l2) is encoded by three clauses, where l1 and l2 are literals of variables
+  y may depend on. The remaining clauses are random.
+*/
+class InstanceGenerator {
+public:
+  InstanceGenerator(int nr_variables, int nr_blocks, int seed): nr_variables(nr_variables), block(nr_variables + 1, 0), generator(seed) {
+    // Blocks alternate and the innermost block is existential.
+    for (int v = 1; v <= nr_variables; v++) {
+      block[v] = (long(v - 1) * nr_blocks) / nr_variables;
+    }
+    universal_parity = (nr_blocks - 1) % 2 == 0 ? 1 : 0;
+  }
+
+  bool isUniversal(int variable) {
+    return block[variable] % 2 == universal_parity;
+  }
+
+  void makeDependencies(int nr_sets, int set_size) {
+    // Outer half of the variables is universal, the rest depends on one of nr_sets dependency sets.
+    int nr_universals = std::max(1, nr_variables / 2);
+    for (int v = 1; v <= nr_variables; v++) {
+      block[v] = (v <= nr_universals) ? universal_parity : 1 - universal_parity;
+    }
+    vector<vector<int>> sets(std::max(1, nr_sets));
+    for (auto& set: sets) {
+      for (int i = 0; i < set_size; i++) {
+        int u = randomVariable(1, nr_universals);
+        if (std::find(set.begin(), set.end(), u) == set.end()) {
+          set.push_back(u);
+        }
+      }
+      std::sort(set.begin(), set.end());
+    }
+    dependencies.assign(nr_variables + 1, {});
+    for (int v = nr_universals + 1; v <= nr_variables; v++) {
+      dependencies[v] = sets[randomVariable(0, sets.size() - 1)];
+    }
+  }
+
+  void plantDefinitions(int nr_definitions) {
+    vector<int> candidates;
+    for (int v = 1; v <= nr_variables; v++) {
+      if (!isUniversal(v) && !candidateInputs(v).empty()) {
+        candidates.push_back(v);
+      }
+    }
+    std::shuffle(candidates.begin(), candidates.end(), generator);
+    candidates.resize(std::min<size_t>(candidates.size(), nr_definitions));
+    for (auto y: candidates) {
+      auto inputs = candidateInputs(y);
+      int first = randomLiteral(inputs);
+      int second = randomLiteral(inputs);
+      clauses.push_back({y, -first, -second});
+      clauses.push_back({-y, first});
+      clauses.push_back({-y, second});
+    }
+  }
+
+  void addRandomClauses(int nr_clauses, int clause_size) {
+    for (int c = 0; c < nr_clauses; c++) {
+      vector<int> clause;
+      for (int l = 0; l < clause_size; l++) {
+        int v = randomVariable(1, nr_variables);
+        clause.push_back(generator() % 2 ? v : -v);
+      }
+      clauses.push_back(clause);
+    }
+  }
+
+  void writeQDIMACS(std::ostream& out) {
+    out << "p cnf " << nr_variables << " " << clauses.size() << std::endl;
+    for (int v = 1; v <= nr_variables; v++) {
+      if (v == 1 || block[v] != block[v - 1]) {
+        if (v > 1) {
+          out << "0" << std::endl;
+        }
+        out << (isUniversal(v) ? "a " : "e ");
+      }
+      out << v << " ";
+    }
+    out << "0" << std::endl;
+    writeClauses(out);
+  }
+
+  void writeDQDIMACS(std::ostream& out) {
+    out << "p cnf " << nr_variables << " " << clauses.size() << std::endl;
+    out << "a ";
+    for (int v = 1; v <= nr_variables && isUniversal(v); v++) {
+      out << v << " ";
+    }
+    out << "0" << std::endl;
+    for (int v = 1; v <= nr_variables; v++) {
+      if (!isUniversal(v)) {
+        out << "d " << v << " ";
+        for (auto u: dependencies[v]) {
+          out << u << " ";
+        }
+        out << "0" << std::endl;
+      }
+    }
+    writeClauses(out);
+  }
+
+  void writeQCIR(std::ostream& out) {
+    out << "#QCIR-G14" << std::endl;
+    for (int v = 1; v <= nr_variables; v++) {
+      if (v == 1 || block[v] != block[v - 1]) {
+        if (v > 1) {
+          out << ")" << std::endl;
+        }
+        out << (isUniversal(v) ? "forall(" : "exists(") << v;
+      } else {
+        out << ", " << v;
+      }
+    }
+    out << ")" << std::endl;
+    int output_gate = nr_variables + clauses.size() + 1;
+    out << "output(" << output_gate << ")" << std::endl;
+    for (unsigned c = 0; c < clauses.size(); c++) {
+      out << nr_variables + c + 1 << " = or(";
+      for (unsigned i = 0; i < clauses[c].size(); i++) {
+        out << (i ? ", " : "") << clauses[c][i];
+      }
+      out << ")" << std::endl;
+    }
+    out << output_gate << " = and(";
+    for (unsigned c = 0; c < clauses.size(); c++) {
+      out << (c ? ", " : "") << nr_variables + c + 1;
+    }
+    out << ")" << std::endl;
+  }
+
+protected:
+  int randomVariable(int first, int last) {
+    return std::uniform_int_distribution<int>(first, last)(generator);
+  }
+
+  int randomLiteral(vector<int>& variables) {
+    int v = variables[randomVariable(0, variables.size() - 1)];
+    return generator() % 2 ? v : -v;
+  }
+
+  vector<int> candidateInputs(int variable) {
+    if (!dependencies.empty()) {
+      return dependencies[variable];
+    }
+    vector<int> inputs;
+    for (int v = 1; v <= nr_variables && block[v] < block[variable]; v++) {
+      inputs.push_back(v);
+    }
+    return inputs;
+  }
+
+  void writeClauses(std::ostream& out) {
+    for (auto& clause: clauses) {
+      for (auto literal: clause) {
+        out << literal << " ";
+      }
+      out << "0" << std::endl;
+    }
+  }
+
+  int nr_variables;
+  int universal_parity;
+  vector<int> block;
+  vector<vector<int>> dependencies;
+  vector<vector<int>> clauses;
+  std::mt19937 generator;
+};
+
+int main(int argc, char* argv[]) {
+  std::map<std::string, docopt::value> args = docopt::docopt(USAGE, { argv + 1, argv + argc }, true, "Unique instance generator v.0.1");
+
+  format output_format = format::QDIMACS;
+  if (args["--format"].asString() == "QDIMACS") {
+    output_format = format::QDIMACS;
+  } else if (args["--format"].asString() == "QCIR") {
+    output_format = format::QCIR;
+  } else if (args["--format"].asString() == "DQDIMACS") {
+    output_format = format::DQDIMACS;
+  } else {
+    std::cerr << "Invalid output format: " << args["--format"].asString() << ", using default (QDIMACS)." << std::endl;
+  }
+
+  int nr_variables = std::max(1L, args["--variables"].asLong());
+  int nr_blocks = std::max(1L, std::min(long(nr_variables), args["--blocks"].asLong()));
+  InstanceGenerator instance_generator(nr_variables, nr_blocks, args["--seed"].asLong());
+  if (output_format == format::DQDIMACS) {
+    instance_generator.makeDependencies(args["--dependency-sets"].asLong(), args["--dependencies"].asLong());
+  }
+  instance_generator.plantDefinitions(args["--planted"].asLong());
+  instance_generator.addRandomClauses(args["--clauses"].asLong(), args["--clause-size"].asLong());
+
+  std::ofstream file;
+  if (args["--output-file"]) {
+    file.open(args["--output-file"].asString());
+    if (!file) {
+      std::cerr << "Error opening file: " << args["--output-file"].asString() << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& out = args["--output-file"] ? file : std::cout;
+
+  if (output_format == format::QDIMACS) {
+    instance_generator.writeQDIMACS(out);
+  } else if (output_format == format::QCIR) {
+    instance_generator.writeQCIR(out);
+  } else {
+    instance_generator.writeDQDIMACS(out);
+  }
+  return 0;
+}
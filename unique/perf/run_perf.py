@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+End-to-end performance regression check: generates an instance family with
+unique_generator, runs unique on it, and compares wall time, peak memory and
+the number of definitions found against a stored baseline. With
+--record-missing, it only records a baseline for a family that has none (the
+CTest fixture that runs before the comparison).
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+# Generator arguments and input suffix for each family.
+FAMILIES = {
+    "qdimacs_small": (["--format", "QDIMACS", "--variables", "200", "--clauses", "300", "--blocks", "2", "--planted", "40"], ".qdimacs"),
+    "qdimacs_large": (["--format", "QDIMACS", "--variables", "20000", "--clauses", "30000", "--blocks", "4", "--planted", "4000"], ".qdimacs"),
+    "qcir_small": (["--format", "QCIR", "--variables", "200", "--clauses", "300", "--blocks", "2", "--planted", "40"], ".qcir"),
+    "qcir_large": (["--format", "QCIR", "--variables", "20000", "--clauses", "30000", "--blocks", "4", "--planted", "4000"], ".qcir"),
+    "dqdimacs_small": (["--format", "DQDIMACS", "--variables", "200", "--clauses", "300", "--dependencies", "8", "--planted", "40"], ".dqdimacs"),
+    "dqdimacs_large": (["--format", "DQDIMACS", "--variables", "20000", "--clauses", "30000", "--dependencies", "32", "--planted", "4000"], ".dqdimacs"),
+}
+
+
+def run_family(unique, generator, family):
+    generator_args, suffix = FAMILIES[family]
+    with tempfile.TemporaryDirectory() as directory:
+        instance = os.path.join(directory, family + suffix)
+        stats = os.path.join(directory, "stats.json")
+        subprocess.run([generator, "--seed", "1", "--output-file", instance] + generator_args, check=True)
+        subprocess.run([unique, "--conflict-limit", "0", "--output-file", os.devnull, "--stats-json", stats, instance], check=True, stderr=subprocess.DEVNULL)
+        with open(stats) as f:
+            data = json.load(f)
+    return {
+        "wall_time": data["wall_time"],
+        "peak_memory_kb": data["peak_memory_kb"],
+        "defined": sum(1 for v in data["variables"] if v["result"] == "defined"),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--unique", required=True)
+    parser.add_argument("--generator", required=True)
+    parser.add_argument("--baseline", required=True)
+    parser.add_argument("--family", required=True, choices=sorted(FAMILIES))
+    parser.add_argument("--tolerance", type=float, default=0.25, help="allowed relative increase of time and memory")
+    parser.add_argument("--update", action="store_true", help="store the measurements as the new baseline")
+    parser.add_argument("--record-missing", action="store_true", help="store the measurements only if there is no baseline for the family")
+    args = parser.parse_args()
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    if args.record_missing and args.family in baseline:
+        print("Baseline for %s in %s exists." % (args.family, args.baseline))
+        return 0
+    if not (args.update or args.record_missing) and args.family not in baseline:
+        print("No baseline for %s in %s (rerun with --update or --record-missing)." % (args.family, args.baseline))
+        return 1
+
+    result = run_family(args.unique, args.generator, args.family)
+    print("%s: %.3fs, %d KB, %d defined" % (args.family, result["wall_time"], result["peak_memory_kb"], result["defined"]))
+
+    if args.update or args.record_missing:
+        baseline[args.family] = result
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+        print("Updated baseline: " + args.baseline)
+        return 0
+
+    expected = baseline[args.family]
+    failed = False
+    for key in ("wall_time", "peak_memory_kb"):
+        if result[key] > expected[key] * (1 + args.tolerance):
+            print("Regression in %s: %s (baseline %s)" % (key, result[key], expected[key]))
+            failed = True
+    if result["defined"] < expected["defined"]:
+        print("Regression in definitions found: %d (baseline %d)" % (result["defined"], expected["defined"]))
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
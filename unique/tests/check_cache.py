@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+End-to-end check of the definability cache: runs unique with --cache on
+small instances generated with unique_generator, then on the same instances
+with one more variable in the last block and a clause that connects it to a
+universal variable. Results for variables whose cone does not reach the new
+clause must be taken from the cache (at least one hit over all instances), and
+the variables defined in the second run must be the ones defined without a
+cache.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from check_definitions import aiger_symbols
+
+GENERATOR_ARGS = ["--format", "QDIMACS", "--variables", "60", "--clauses", "40", "--blocks", "2", "--planted", "25"]
+
+CACHE_STATISTICS = re.compile(rb"^Cache: (\d+) hits, (\d+) misses\.$", re.MULTILINE)
+
+
+def extend_instance(text):
+    # Adds variable n + 1 to the last (existential) block and the clause (u | n + 1) for the first universal u.
+    lines = text.splitlines()
+    _, _, nr_variables, nr_clauses = lines[0].split()
+    nr_variables, nr_clauses = int(nr_variables), int(nr_clauses)
+    prefix = [line for line in lines[1:] if line.startswith(("a ", "e "))]
+    clauses = [line for line in lines[1:] if line and not line.startswith(("a ", "e "))]
+    universals = [line for line in prefix if line.startswith("a ")]
+    if not universals or not prefix[-1].startswith("e "):
+        return None
+    universal = universals[0].split()[1]
+    new_variable = nr_variables + 1
+    prefix[-1] = prefix[-1][:-1] + "%d 0" % new_variable
+    clauses.append("%s %d 0" % (universal, new_variable))
+    header = "p cnf %d %d" % (new_variable, nr_clauses + 1)
+    return "\n".join([header] + prefix + clauses) + "\n"
+
+
+def run(unique, arguments, instance):
+    # Without a conflict limit, so that the results do not depend on the state of the solver (and without
+    # preprocessing, the default, so that the new clause is not eliminated).
+    result = subprocess.run([unique, "--conflict-limit", "0", "--output-format", "AIGER"] + arguments + [instance], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        raise RuntimeError("unique exited with %d" % result.returncode)
+    hits = CACHE_STATISTICS.search(result.stderr)
+    return set(aiger_symbols(result.stdout)[1]), int(hits.group(1)) if hits else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--unique", required=True)
+    parser.add_argument("--generator", required=True)
+    parser.add_argument("--seeds", type=int, default=20)
+    args = parser.parse_args()
+
+    failed = False
+    total_hits = 0
+    with tempfile.TemporaryDirectory() as directory:
+        instance = os.path.join(directory, "instance.qdimacs")
+        extended = os.path.join(directory, "extended.qdimacs")
+        cache = os.path.join(directory, "cache")
+        for seed in range(1, args.seeds + 1):
+            subprocess.run([args.generator, "--seed", str(seed), "--output-file", instance] + GENERATOR_ARGS, check=True)
+            with open(instance) as f:
+                text = extend_instance(f.read())
+            if text is None:
+                continue
+            with open(extended, "w") as f:
+                f.write(text)
+            if os.path.exists(cache):
+                os.remove(cache)
+            try:
+                run(args.unique, ["--cache", cache], instance)
+                defined, hits = run(args.unique, ["--cache", cache], extended)
+                expected, _ = run(args.unique, [], extended)
+            except RuntimeError as error:
+                print("seed %d: %s" % (seed, error))
+                failed = True
+                continue
+            total_hits += hits
+            if defined != expected:
+                print("seed %d: defined with the cache: %s, without: %s" % (seed, b" ".join(sorted(defined)).decode(), b" ".join(sorted(expected)).decode()))
+                failed = True
+    if total_hits == 0:
+        print("no cache hits after extending the instances")
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
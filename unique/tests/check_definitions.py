@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+End-to-end check of minimized definitions: runs unique with --minimize on the
+instances in this directory and on small instances generated with
+unique_generator, and checks that definitions are acyclic. In the QCIR output, every gate may only use variables of the prefix
+and earlier gates. In the AIGER output, outputs (defined variables) must be
+distinct and no output may also be an input. Variables defined with a small
+conflict limit and several rounds must also be defined without a limit.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+# Small instances with many planted definitions, so that minimization has nodes to merge.
+GENERATOR_ARGS = ["--format", "QDIMACS", "--variables", "60", "--clauses", "40", "--blocks", "2", "--planted", "25"]
+
+GATE = re.compile(r"^(\S+)\s*=\s*(\w+)\((.*)\)$")
+STATEMENT = re.compile(r"^(\w+)\((.*)\)$")
+
+
+def arguments(text):
+    return [argument.strip() for argument in text.split(",") if argument.strip()]
+
+
+def check_qcir(text):
+    declared = set()
+    output = None
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        gate = GATE.match(line)
+        if gate:
+            name, _, inputs = gate.groups()
+            for literal in arguments(inputs):
+                if literal.lstrip("-") not in declared:
+                    return "gate %s uses %s before it is defined" % (name, literal)
+            if name in declared:
+                return "gate %s is defined twice" % name
+            declared.add(name)
+            continue
+        statement = STATEMENT.match(line)
+        if not statement:
+            return "unexpected line: " + line
+        keyword, variables = statement.groups()
+        if keyword == "output":
+            output = variables.strip().lstrip("-")
+        else:
+            declared.update(arguments(variables))
+    if output is not None and output not in declared:
+        return "output %s is not defined" % output
+    return None
+
+
+def aiger_symbols(data):
+    # The symbol table follows the binary AND section, each entry is on its own line.
+    inputs, outputs = [], []
+    for line in data.split(b"\n"):
+        if line == b"c":
+            break
+        match = re.match(rb"^([io])\d+ (.+)$", line)
+        if match:
+            (inputs if match.group(1) == b"i" else outputs).append(match.group(2))
+    return inputs, outputs
+
+
+def check_aiger(data):
+    inputs, outputs = aiger_symbols(data)
+    if len(set(outputs)) != len(outputs):
+        return "a variable is defined twice"
+    cyclic = set(inputs) & set(outputs)
+    if cyclic:
+        return "defined variables are also inputs: " + b" ".join(sorted(cyclic)).decode()
+    return None
+
+
+def run(unique, arguments, instance):
+    result = subprocess.run([unique, "--minimize"] + arguments + [instance], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    if result.returncode != 0:
+        raise RuntimeError("unique exited with %d" % result.returncode)
+    return result.stdout
+
+
+def check_instance(unique, mode, instance, name):
+    passed = True
+    defined = []
+    # A small conflict limit leaves variables for the later rounds.
+    for conflict_limit, rounds in (("0", "1"), ("1", "3")):
+        common = ["--mode", mode, "--conflict-limit", conflict_limit, "--rounds", rounds]
+        try:
+            aiger = run(unique, common + ["--output-format", "AIGER"], instance)
+            errors = [check_qcir(run(unique, common, instance).decode()), check_aiger(aiger)]
+            defined.append(set(aiger_symbols(aiger)[1]))
+        except RuntimeError as error:
+            errors = [str(error)]
+        for error in errors:
+            if error:
+                print("%s, conflict limit %s, %s rounds: %s" % (name, conflict_limit, rounds, error))
+                passed = False
+    if len(defined) == 2 and not defined[1] <= defined[0]:
+        print("%s: defined only with rounds: %s" % (name, b" ".join(sorted(defined[1] - defined[0])).decode()))
+        passed = False
+    return passed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--unique", required=True)
+    parser.add_argument("--generator", required=True)
+    parser.add_argument("--mode", required=True, choices=["both", "other-defined"])
+    parser.add_argument("--seeds", type=int, default=20)
+    args = parser.parse_args()
+
+    directory = os.path.dirname(os.path.abspath(__file__))
+    failed = False
+    for name in sorted(os.listdir(directory)):
+        if name.endswith(".qdimacs"):
+            failed |= not check_instance(args.unique, args.mode, os.path.join(directory, name), name)
+    with tempfile.TemporaryDirectory() as directory:
+        instance = os.path.join(directory, "instance.qdimacs")
+        for seed in range(1, args.seeds + 1):
+            subprocess.run([args.generator, "--seed", str(seed), "--output-file", instance] + GENERATOR_ARGS, check=True)
+            failed |= not check_instance(args.unique, args.mode, instance, "seed %d" % seed)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""
+Equivalence check of output simplification, preprocessing and gate hashing:
+runs unique on the QCIR instances in this directory (with XOR and ITE gates)
+and on small instances generated with unique_generator, by default, with
+--no-simplify and with --preprocess. Each generated instance is also given
+as QCIR, once with one gate per clause and once with every clause gate
+repeated as a negated AND gate that the parser has to merge with it. The
+output of every run must have the truth value of the input (evaluated by
+brute force), and every run must define the same variables.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+from check_definitions import GATE, STATEMENT, aiger_symbols, arguments, check_qcir
+
+# Few variables, so that the instances can be evaluated by brute force.
+GENERATOR_ARGS = ["--format", "QDIMACS", "--variables", "10", "--clauses", "12", "--blocks", "3", "--planted", "4"]
+
+OPTIONS = [[], ["--no-simplify"], ["--preprocess"]]
+
+
+def parse_qcir(text):
+    # Returns the prefix as a list of (quantifier, variable), the gates in order and the output literal.
+    prefix, gates, output = [], [], None
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        gate = GATE.match(line)
+        if gate:
+            name, gate_type, inputs = gate.groups()
+            gates.append((name, gate_type, arguments(inputs)))
+            continue
+        keyword, variables = STATEMENT.match(line).groups()
+        if keyword == "output":
+            output = variables.strip()
+        else:
+            prefix.extend((keyword, variable) for variable in arguments(variables))
+    return prefix, gates, output
+
+
+def evaluate_gate(gate_type, values):
+    if gate_type == "and":
+        return all(values)
+    if gate_type == "or":
+        return any(values)
+    if gate_type == "xor":
+        return values[0] != values[1]
+    return values[1] if values[0] else values[2]
+
+
+def truth_value(text):
+    prefix, gates, output = parse_qcir(text)
+    declared = set(variable for _, variable in prefix) | set(name for name, _, _ in gates)
+    # Variables that occur in gates but are neither quantified nor gates are free (existential in the outermost block).
+    free = [("exists", literal.lstrip("-")) for _, _, inputs in gates for literal in inputs if literal.lstrip("-") not in declared]
+    prefix = list(dict.fromkeys(free)) + prefix
+
+    def value(assignment, literal):
+        result = assignment[literal.lstrip("-")]
+        return not result if literal.startswith("-") else result
+
+    def evaluate(index, assignment):
+        if index == len(prefix):
+            for name, gate_type, inputs in gates:
+                assignment[name] = evaluate_gate(gate_type, [value(assignment, literal) for literal in inputs])
+            return value(assignment, output)
+        quantifier, variable = prefix[index]
+        results = (evaluate(index + 1, dict(assignment, **{variable: polarity})) for polarity in (False, True))
+        return any(results) if quantifier == "exists" else all(results)
+
+    return evaluate(0, {})
+
+
+def qdimacs_to_qcir(text, repeat_gates):
+    # One OR gate per clause, numbered after the variables. With repeat_gates, each clause gate is followed by
+    # and(-l_k, ..., -l_1, -l_1), which is its negation, and the output uses both.
+    lines = [line.split() for line in text.splitlines() if line.strip() and not line.startswith("c")]
+    nr_variables = int(lines[0][2])
+    blocks = [(("forall" if line[0] == "a" else "exists"), line[1:-1]) for line in lines[1:] if line[0] in ("a", "e")]
+    clauses = [line[:-1] for line in lines[1:] if line[0] not in ("a", "e")]
+    result = ["#QCIR-G14"] + ["%s(%s)" % (quantifier, ", ".join(variables)) for quantifier, variables in blocks]
+    gates, output_inputs = [], []
+    for clause in clauses:
+        name = str(nr_variables + len(gates) + 1)
+        gates.append("%s = or(%s)" % (name, ", ".join(clause)))
+        output_inputs.append(name)
+        if repeat_gates:
+            negated = [literal[1:] if literal.startswith("-") else "-" + literal for literal in reversed(clause)]
+            repeated = str(nr_variables + len(gates) + 1)
+            gates.append("%s = and(%s)" % (repeated, ", ".join(negated + negated[-1:])))
+            output_inputs.append("-" + repeated)
+    output = str(nr_variables + len(gates) + 1)
+    result.append("output(%s)" % output)
+    result.extend(gates)
+    result.append("%s = and(%s)" % (output, ", ".join(output_inputs)))
+    return "\n".join(result) + "\n"
+
+
+def run(unique, arguments, instance):
+    # Without a conflict limit, so that the defined variables do not depend on the encoding of the matrix.
+    result = subprocess.run([unique, "--conflict-limit", "0"] + arguments + [instance], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    if result.returncode != 0:
+        raise RuntimeError("unique exited with %d" % result.returncode)
+    return result.stdout
+
+
+def check_instances(unique, instances, qcir, name):
+    # All instances encode the same QBF, qcir is one of them in QCIR.
+    prefix, _, _ = parse_qcir(qcir)
+    variables = set(variable.encode() for _, variable in prefix)
+    expected_value = truth_value(qcir)
+    passed = True
+    expected_defined = None
+    for instance in instances:
+        for options in OPTIONS:
+            description = "%s (%s%s)" % (name, os.path.basename(instance), "".join(" " + option for option in options))
+            try:
+                output = run(unique, options, instance).decode()
+                defined = set(aiger_symbols(run(unique, options + ["--output-format", "AIGER"], instance))[1]) & variables
+            except RuntimeError as error:
+                print("%s: %s" % (description, error))
+                passed = False
+                continue
+            error = check_qcir(output)
+            if error:
+                print("%s: %s" % (description, error))
+                passed = False
+            elif truth_value(output) != expected_value:
+                print("%s: output is %s, input is %s" % (description, not expected_value, expected_value))
+                passed = False
+            if expected_defined is None:
+                expected_defined = defined
+            elif defined != expected_defined:
+                print("%s: defines %s instead of %s" % (description, b" ".join(sorted(defined)).decode(), b" ".join(sorted(expected_defined)).decode()))
+                passed = False
+    return passed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--unique", required=True)
+    parser.add_argument("--generator", required=True)
+    parser.add_argument("--seeds", type=int, default=20)
+    args = parser.parse_args()
+
+    directory = os.path.dirname(os.path.abspath(__file__))
+    failed = False
+    for name in sorted(os.listdir(directory)):
+        if name.endswith(".qcir"):
+            instance = os.path.join(directory, name)
+            with open(instance) as f:
+                failed |= not check_instances(args.unique, [instance], f.read(), name)
+    with tempfile.TemporaryDirectory() as directory:
+        instance = os.path.join(directory, "instance.qdimacs")
+        clause_gates = os.path.join(directory, "instance.qcir")
+        repeated_gates = os.path.join(directory, "repeated.qcir")
+        for seed in range(1, args.seeds + 1):
+            subprocess.run([args.generator, "--seed", str(seed), "--output-file", instance] + GENERATOR_ARGS, check=True)
+            with open(instance) as f:
+                text = f.read()
+            qcir = qdimacs_to_qcir(text, False)
+            with open(clause_gates, "w") as f:
+                f.write(qcir)
+            with open(repeated_gates, "w") as f:
+                f.write(qdimacs_to_qcir(text, True))
+            failed |= not check_instances(args.unique, [instance, clause_gates, repeated_gates], qcir, "seed %d" % seed)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""
+Concurrency check of signal handling: runs unique with concurrent passes and
+a solver portfolio on a generated instance and sends SIGINT after varying
+delays once the extraction has started. Every run must exit normally (no
+crash or hang) and write well-formed QCIR with the definitions found so far.
+"""
+
+import argparse
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+from check_definitions import check_qcir
+
+GENERATOR_ARGS = ["--format", "QDIMACS", "--variables", "2000", "--clauses", "3000", "--blocks", "3", "--planted", "800"]
+UNIQUE_ARGS = ["--concurrent-passes", "--portfolio", "2", "--conflict-limit", "10", "--rounds", "3"]
+DELAYS = [0.0, 0.01, 0.05, 0.1, 0.2, 0.5, 1.0]
+TIMEOUT = 120
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--unique", required=True)
+    parser.add_argument("--generator", required=True)
+    parser.add_argument("--seeds", type=int, default=3)
+    args = parser.parse_args()
+
+    failed = False
+    with tempfile.TemporaryDirectory() as directory:
+        instance = os.path.join(directory, "instance.qdimacs")
+        for seed in range(1, args.seeds + 1):
+            subprocess.run([args.generator, "--seed", str(seed), "--output-file", instance] + GENERATOR_ARGS, check=True)
+            for delay in DELAYS:
+                name = "seed %d, SIGINT after %.2fs" % (seed, delay)
+                process = subprocess.Popen([args.unique] + UNIQUE_ARGS + [instance], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                # Signals are handled from the start of the extraction, parsing is not interrupted.
+                for line in process.stderr:
+                    if line.startswith(b"Processing"):
+                        break
+                time.sleep(delay)
+                process.send_signal(signal.SIGINT)
+                try:
+                    output, _ = process.communicate(timeout=TIMEOUT)
+                except subprocess.TimeoutExpired:
+                    process.kill()
+                    process.communicate()
+                    print("%s: no exit within %ds" % (name, TIMEOUT))
+                    failed = True
+                    continue
+                if process.returncode != 0:
+                    print("%s: exited with %d" % (name, process.returncode))
+                    failed = True
+                    continue
+                error = check_qcir(output.decode())
+                if error:
+                    print("%s: %s" % (name, error))
+                    failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())